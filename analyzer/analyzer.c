@@ -0,0 +1,564 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../dacap.h"
+
+// Офлайн-анализатор журналов details_<ip>.txt и stats_<ip>.csv.
+// Файлы читаются потоково крупными блоками, поэтому объём памяти не зависит от размера журналов.
+// Журналы нескольких узлов сливаются в одну временную шкалу по меткам времени.
+
+#define READ_CHUNK_SIZE     (4 * 1024 * 1024)   // Размер блока чтения файла
+#define MAX_LINE_LENGTH     4096                // Строки длиннее обрезаются
+#define MAX_LATENCY_MS      60000               // Верхняя граница гистограммы задержек
+#define DEFAULT_WINDOW_SEC  60                  // Окно подсчёта пропускной способности по умолчанию
+#define TIMESTAMP_LENGTH    23                  // Длина метки "YYYY-MM-DD HH:MM:SS.mmm"
+
+/// Виды событий рукопожатия RTS -> CTS -> INFO -> DELIVERED
+typedef enum {
+    HS_OPEN,    // Отправлен RTS
+    HS_CTS,     // CTS отправлен получателем или принят отправителем
+    HS_INFO,    // INFO отправлен или принят
+    HS_DONE,    // Получен DELIVERED
+    HS_FAIL,    // Отказ открытого рукопожатия (таймаут или ошибка отправки CTS)
+    HS_REFUSED  // RTS не удалось отправить: попытка неудачна, рукопожатие не открывалось
+} HandshakeEvent;
+
+/// Виды журналов
+typedef enum {
+    LOG_DETAILS,    // details_<ip>.txt
+    LOG_STATS       // stats_<ip>.csv
+} LogKind;
+
+/// @brief Событие временной шкалы
+typedef struct {
+    long long timestamp_ms; // Время события, мс от 1970-01-01 (UTC)
+    HandshakeEvent event;   // Вид события
+    int sender;             // Отправитель сообщения (инициатор RTS)
+    int receiver;           // Получатель сообщения (-1 - последний адресат отправителя)
+} Event;
+
+/// @brief Потоковое чтение одного журнала
+typedef struct {
+    FILE *file;                 // Файл журнала
+    const char *path;           // Путь к файлу
+    LogKind kind;               // Вид журнала
+    int node;                   // Адрес узла, взятый из имени файла
+    int correlate;              // Признак передачи событий в разбор рукопожатий
+    char *buffer;               // Буфер чтения
+    size_t pos;                 // Начало непрочитанных данных в буфере
+    size_t len;                 // Конец данных в буфере
+    int eof;                    // Признак конца файла
+    char date_key[10];          // Дата последней разобранной метки времени
+    long long date_ms;          // Начало этой даты в мс
+    Event next;                 // Очередное событие
+    int has_next;               // Признак наличия очередного события
+    unsigned long long lines;   // Количество прочитанных строк
+} LogReader;
+
+/// @brief Состояние и статистика пары отправитель -> получатель
+typedef struct {
+    long long rts_ms;               // Время RTS открытого рукопожатия
+    unsigned char open;             // Признак открытого рукопожатия
+    unsigned char cts;              // В открытом рукопожатии был CTS
+    unsigned int success;           // Успешные рукопожатия
+    unsigned int failure;           // Неудачные рукопожатия
+    unsigned long long latency_sum; // Сумма задержек успешных рукопожатий, мс
+} PairStats;
+
+/// @brief Счётчики одного окна времени
+typedef struct {
+    long long start_ms;     // Начало окна
+    unsigned int opened;    // Отправлено RTS
+    unsigned int delivered; // Получено DELIVERED
+    unsigned int failed;    // Отказов
+} WindowStats;
+
+static PairStats pairs[DACAP_MAX_ADDRESS + 1][DACAP_MAX_ADDRESS + 1];  // Статистика по парам
+static int last_receiver[DACAP_MAX_ADDRESS + 1];                        // Последний адресат RTS по отправителю
+static unsigned long long latency_hist[MAX_LATENCY_MS + 1];             // Гистограмма задержек, мс
+static unsigned long long latency_count = 0;    // Количество замеров задержки
+static unsigned long long orphan_delivered = 0; // DELIVERED без открытого рукопожатия
+static unsigned long long failed_no_cts = 0;    // Отказы до получения CTS
+static unsigned long long failed_after_cts = 0; // Отказы после CTS
+static WindowStats window;                      // Текущее окно
+static int window_started = 0;                  // Признак того, что текущее окно начато
+static long long window_ms = DEFAULT_WINDOW_SEC * 1000LL;
+
+/// @brief Разбор числа из фиксированного количества цифр
+/// @param p        - начало числа
+/// @param digits   - количество цифр
+/// @return         - число или -1, если встретился не цифровой символ
+static int parse_fixed(const char *p, int digits) {
+    int value = 0;
+    for (int i = 0; i < digits; i++) {
+        unsigned d = (unsigned)(p[i] - '0');
+        if (d > 9) return -1;
+        value = value * 10 + (int)d;
+    }
+    return value;
+}
+
+/// @brief Количество дней от 1970-01-01 до указанной даты (григорианский календарь)
+static long long days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (unsigned)(m + (m > 2 ? -3 : 9)) + 2) / 5 + (unsigned)d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (long long)doe - 719468;
+}
+
+/// @brief Обратное преобразование: дни от 1970-01-01 в дату
+static void civil_from_days(long long z, int *y, int *m, int *d) {
+    z += 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+/// @brief Разбор метки времени "YYYY-MM-DD HH:MM:SS.mmm" (формат logger.c)
+/// Дата меняется редко, поэтому результат её разбора кэшируется в объекте чтения.
+/// @param reader   - объект чтения (кэш даты)
+/// @param p        - начало метки (не менее TIMESTAMP_LENGTH символов)
+/// @param out      - время в мс
+/// @return         - 0 при успехе, -1 при неверном формате
+static int parse_timestamp(LogReader *reader, const char *p, long long *out) {
+    if (p[4] != '-' || p[7] != '-' || p[10] != ' ' || p[13] != ':' || p[16] != ':' || p[19] != '.') {
+        return -1;
+    }
+    if (memcmp(p, reader->date_key, sizeof(reader->date_key)) != 0) {
+        int y = parse_fixed(p, 4), m = parse_fixed(p + 5, 2), d = parse_fixed(p + 8, 2);
+        if (y < 0 || m < 1 || m > 12 || d < 1 || d > 31) return -1;
+        reader->date_ms = days_from_civil(y, m, d) * 86400000LL;
+        memcpy(reader->date_key, p, sizeof(reader->date_key));
+    }
+    int hh = parse_fixed(p + 11, 2), mm = parse_fixed(p + 14, 2), ss = parse_fixed(p + 17, 2), ms = parse_fixed(p + 20, 3);
+    if (hh < 0 || mm < 0 || ss < 0 || ms < 0) return -1;
+    *out = reader->date_ms + ((hh * 60LL + mm) * 60 + ss) * 1000 + ms;
+    return 0;
+}
+
+/// @brief Разбор целого числа до первого не цифрового символа
+/// @param p    - позиция разбора, сдвигается за число
+/// @param end  - конец строки
+/// @return     - число
+static int parse_int(const char **p, const char *end) {
+    const char *s = *p;
+    int sign = 1, value = 0;
+    if (s < end && *s == '-') {
+        sign = -1;
+        s++;
+    }
+    while (s < end && (unsigned)(*s - '0') <= 9) {
+        value = value * 10 + (*s - '0');
+        s++;
+    }
+    *p = s;
+    return sign * value;
+}
+
+/// @brief Проверка префикса и пропуск его
+static int skip_prefix(const char **p, const char *end, const char *prefix, size_t length) {
+    if ((size_t)(end - *p) < length || memcmp(*p, prefix, length) != 0) return 0;
+    *p += length;
+    return 1;
+}
+
+/// @brief Разбор строки stats_<ip>.csv: "<метка>,<тип>,<размер>,<src>,<dest>,<успех>"
+/// @return - 1, если строка дала событие, иначе 0
+static int parse_stats_line(LogReader *reader, const char *p, const char *end, Event *event) {
+    int type, size, src, dest, success;
+
+    if (end - p < TIMESTAMP_LENGTH + 2 || parse_timestamp(reader, p, &event->timestamp_ms) != 0) {
+        return 0;   // Заголовок или повреждённая строка
+    }
+    p += TIMESTAMP_LENGTH + 1;
+    switch (*p) {
+        case 'R': type = MSG_RTS; break;
+        case 'C': type = MSG_CTS; break;
+        case 'I': type = MSG_INFO; break;
+        case 'D': type = MSG_DELIVERED; break;
+        default: return 0;
+    }
+    p = memchr(p, ',', (size_t)(end - p));
+    if (!p) return 0;
+    p++;
+    size = parse_int(&p, end);
+    if (!skip_prefix(&p, end, ",", 1)) return 0;
+    src = parse_int(&p, end);
+    if (!skip_prefix(&p, end, ",", 1)) return 0;
+    dest = parse_int(&p, end);
+    if (!skip_prefix(&p, end, ",", 1)) return 0;
+    success = parse_int(&p, end);
+
+    // Соответствие вызовам log_stats в main.c
+    event->sender = src;
+    event->receiver = dest;
+    switch (type) {
+        case MSG_RTS:
+            event->event = success ? HS_OPEN : HS_REFUSED;
+            break;
+        case MSG_CTS:
+            // Отправленный CTS (размер 3) пишет получатель: src - получатель, dest - отправитель.
+            // Неуспешный CTS с размером 0 пишет отправитель по таймауту ожидания CTS,
+            // с размером 3 - получатель, не сумевший отправить CTS
+            if (success || size != 0) {
+                event->event = success ? HS_CTS : HS_FAIL;
+                event->sender = dest;
+                event->receiver = src;
+            } else {
+                event->event = HS_FAIL;
+            }
+            break;
+        case MSG_INFO:
+            event->event = HS_INFO;
+            break;
+        default:
+            event->event = success ? HS_DONE : HS_FAIL;
+            break;
+    }
+    return 1;
+}
+
+/// @brief Разбор строки details_<ip>.txt: "[<метка>] <сообщение>"
+/// @return - 1, если строка дала событие, иначе 0
+static int parse_details_line(LogReader *reader, const char *p, const char *end, Event *event) {
+    if (end - p < TIMESTAMP_LENGTH + 3 || p[0] != '[' || p[TIMESTAMP_LENGTH + 1] != ']' ||
+        parse_timestamp(reader, p + 1, &event->timestamp_ms) != 0) {
+        return 0;
+    }
+    p += TIMESTAMP_LENGTH + 3;
+
+    // Соответствие сообщениям log_details в main.c и dacap.c
+    if (skip_prefix(&p, end, "Sent RTS to ", 12)) {
+        event->event = HS_OPEN;
+        event->sender = reader->node;
+        event->receiver = parse_int(&p, end);
+    } else if (skip_prefix(&p, end, "Sent CTS to ", 12)) {
+        event->event = HS_CTS;
+        event->sender = parse_int(&p, end);
+        event->receiver = reader->node;
+    } else if (skip_prefix(&p, end, "CTS from ", 9)) {
+        event->event = HS_CTS;
+        event->sender = reader->node;
+        event->receiver = parse_int(&p, end);
+    } else if (skip_prefix(&p, end, "INFO from ", 10)) {
+        event->event = HS_INFO;
+        event->sender = parse_int(&p, end);
+        event->receiver = reader->node;
+    } else if (skip_prefix(&p, end, "DELIVERED for dest ", 19)) {
+        event->event = HS_DONE;
+        event->sender = reader->node;
+        event->receiver = parse_int(&p, end);
+    } else if (skip_prefix(&p, end, "Timeout waiting for ", 20)) {
+        const char *from = p;
+        while (from + 6 <= end && memcmp(from, " from ", 6) != 0) from++;
+        if (from + 6 > end) return 0;
+        from += 6;
+        event->event = HS_FAIL;
+        event->sender = reader->node;
+        event->receiver = parse_int(&from, end);
+    } else if (skip_prefix(&p, end, "Message ", 8)) {
+        parse_int(&p, end);
+        if (!skip_prefix(&p, end, " timed out", 10)) return 0;
+        event->event = HS_FAIL;
+        event->sender = reader->node;
+        event->receiver = -1;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/// @brief Чтение следующего события журнала
+/// @param reader   - объект чтения
+/// @return         - 1, если событие прочитано, 0 - конец файла
+static int reader_advance(LogReader *reader) {
+    while (1) {
+        char *start = reader->buffer + reader->pos;
+        char *newline = memchr(start, '\n', reader->len - reader->pos);
+
+        if (!newline) {
+            if (reader->eof) {
+                if (reader->pos == reader->len) {
+                    reader->has_next = 0;
+                    return 0;
+                }
+                newline = reader->buffer + reader->len;  // Последняя строка без перевода строки
+            } else {
+                // Сдвиг остатка в начало буфера и дочитывание следующего блока
+                size_t rest = reader->len - reader->pos;
+                if (rest >= MAX_LINE_LENGTH) {
+                    rest = 0;   // Слишком длинная строка отбрасывается
+                }
+                memmove(reader->buffer, reader->buffer + reader->len - rest, rest);
+                reader->pos = 0;
+                reader->len = rest;
+                size_t n = fread(reader->buffer + rest, 1, READ_CHUNK_SIZE, reader->file);
+                reader->len += n;
+                if (n == 0) {
+                    reader->eof = 1;
+                }
+                continue;
+            }
+        }
+
+        const char *end = newline;
+        if (end > start && end[-1] == '\r') end--;
+        reader->pos = (size_t)(newline - reader->buffer) + (newline < reader->buffer + reader->len);
+        reader->lines++;
+
+        int parsed = reader->kind == LOG_STATS
+            ? parse_stats_line(reader, start, end, &reader->next)
+            : parse_details_line(reader, start, end, &reader->next);
+        if (parsed) {
+            reader->has_next = 1;
+            return 1;
+        }
+    }
+}
+
+/// @brief Адрес узла по имени файла журнала (последний октет IP, как в main.c)
+static int node_from_path(const char *path) {
+    const char *base = strrchr(path, '/');
+    const char *alt = strrchr(path, '\\');
+    if (alt && (!base || alt > base)) base = alt;
+    base = base ? base + 1 : path;
+
+    // Имя вида <prefix>_a.b.c.d.<ext>: последний октет стоит перед расширением
+    const char *ext = strrchr(base, '.');
+    if (!ext) return 0;
+    const char *octet = ext;
+    while (octet > base && (unsigned)(octet[-1] - '0') <= 9) octet--;
+    return atoi(octet);
+}
+
+/// @brief Форматирование времени в мс как "YYYY-MM-DD HH:MM:SS"
+static void format_time(long long ms, char *out, size_t size) {
+    long long days = ms >= 0 ? ms / 86400000LL : (ms - 86399999LL) / 86400000LL;
+    long long rest = (ms - days * 86400000LL) / 1000;
+    int y, m, d;
+    civil_from_days(days, &y, &m, &d);
+    snprintf(out, size, "%04d-%02d-%02d %02d:%02d:%02d", y, m, d,
+             (int)(rest / 3600), (int)(rest / 60 % 60), (int)(rest % 60));
+}
+
+/// @brief Вывод и сброс текущего окна
+static void flush_window(void) {
+    char start[64];
+    if (!window_started) return;
+    format_time(window.start_ms, start, sizeof(start));
+    printf("%s,%u,%u,%u,%.3f\n", start, window.opened, window.delivered, window.failed,
+           window.delivered * 1000.0 / (double)window_ms);
+    window.opened = window.delivered = window.failed = 0;
+}
+
+/// @brief Учёт отказа открытого рукопожатия (или неудачной отправки RTS)
+static void fail_handshake(PairStats *pair) {
+    pair->failure++;
+    window.failed++;
+    if (pair->open && pair->cts) {
+        failed_after_cts++;
+    } else {
+        failed_no_cts++;
+    }
+    pair->open = 0;
+    pair->cts = 0;
+}
+
+/// @brief Обработка события временной шкалы
+static void handle_event(const Event *event) {
+    long long window_start = event->timestamp_ms - ((event->timestamp_ms % window_ms) + window_ms) % window_ms;
+    int sender = event->sender;
+    int receiver = event->receiver;
+
+    if (!window_started || window_start != window.start_ms) {
+        flush_window();
+        // Окна без событий выводятся нулевыми строками, чтобы в ряду не было пропусков
+        if (window_started) {
+            for (long long empty = window.start_ms + window_ms; empty < window_start; empty += window_ms) {
+                window.start_ms = empty;
+                flush_window();
+            }
+        }
+        window.start_ms = window_start;
+        window_started = 1;
+    }
+
+    if (sender < 0 || sender > DACAP_MAX_ADDRESS) return;
+    if (receiver < 0) receiver = last_receiver[sender];
+    if (receiver < 0 || receiver > DACAP_MAX_ADDRESS) return;
+    PairStats *pair = &pairs[sender][receiver];
+
+    switch (event->event) {
+        case HS_OPEN:
+            // Новый RTS при открытом рукопожатии означает, что предыдущее не завершилось
+            if (pair->open) fail_handshake(pair);
+            pair->open = 1;
+            pair->cts = 0;
+            pair->rts_ms = event->timestamp_ms;
+            last_receiver[sender] = receiver;
+            window.opened++;
+            break;
+        case HS_CTS:
+            if (pair->open) pair->cts = 1;
+            break;
+        case HS_INFO:
+            break;
+        case HS_DONE:
+            if (!pair->open) {
+                orphan_delivered++;
+                break;
+            }
+            {
+                long long latency = event->timestamp_ms - pair->rts_ms;
+                if (latency < 0) latency = 0;
+                if (latency > MAX_LATENCY_MS) latency = MAX_LATENCY_MS;
+                latency_hist[latency]++;
+                latency_count++;
+                pair->latency_sum += (unsigned long long)latency;
+            }
+            pair->success++;
+            pair->open = 0;
+            pair->cts = 0;
+            window.delivered++;
+            break;
+        case HS_FAIL:
+            // Отказ без открытого рукопожатия уже учтён (например, вторым узлом пары) или относится к чужому RTS
+            if (pair->open) fail_handshake(pair);
+            break;
+        case HS_REFUSED:
+            fail_handshake(pair);
+            break;
+    }
+}
+
+/// @brief Перцентиль задержки по гистограмме (nearest-rank)
+static int latency_percentile(double percentile) {
+    unsigned long long rank = (unsigned long long)(percentile / 100.0 * latency_count + 0.999999), seen = 0;
+    if (rank == 0) rank = 1;
+    for (int ms = 0; ms <= MAX_LATENCY_MS; ms++) {
+        seen += latency_hist[ms];
+        if (seen >= rank) return ms;
+    }
+    return MAX_LATENCY_MS;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-w <window seconds>] <details_*.txt | stats_*.csv> ...\n", program);
+}
+
+int main(int argc, char *argv[]) {
+    LogReader *readers;
+    int count = 0;
+    int first_file = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-w") == 0) {
+        window_ms = atoll(argv[2]) * 1000LL;
+        first_file = 3;
+    }
+    if (first_file >= argc || window_ms <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    readers = calloc((size_t)(argc - first_file), sizeof(LogReader));
+    if (!readers) {
+        perror("Failed to allocate readers");
+        return 1;
+    }
+    for (int i = first_file; i < argc; i++) {
+        LogReader *reader = &readers[count];
+        const char *ext = strrchr(argv[i], '.');
+        reader->path = argv[i];
+        reader->kind = ext && strcmp(ext, ".csv") == 0 ? LOG_STATS : LOG_DETAILS;
+        reader->node = node_from_path(argv[i]);
+        reader->correlate = 1;
+        reader->file = fopen(argv[i], "rb");
+        reader->buffer = malloc(READ_CHUNK_SIZE + MAX_LINE_LENGTH);
+        if (!reader->file || !reader->buffer) {
+            perror(argv[i]);
+            if (reader->file) fclose(reader->file);
+            free(reader->buffer);
+            continue;
+        }
+        // Блоки читаются напрямую в свой буфер, буфер stdio не нужен
+        setvbuf(reader->file, NULL, _IONBF, 0);
+        count++;
+    }
+
+    // Если у узла есть stats_, его details_ не используется для рукопожатий:
+    // оба журнала описывают одни и те же события
+    for (int i = 0; i < count; i++) {
+        if (readers[i].kind != LOG_DETAILS) continue;
+        for (int j = 0; j < count; j++) {
+            if (readers[j].kind == LOG_STATS && readers[j].node == readers[i].node) {
+                readers[i].correlate = 0;
+            }
+        }
+    }
+    for (int i = 0; i <= DACAP_MAX_ADDRESS; i++) {
+        last_receiver[i] = -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (readers[i].correlate) {
+            reader_advance(&readers[i]);
+        }
+    }
+
+    // Слияние журналов узлов в одну временную шкалу
+    printf("# Throughput (window %llds)\nwindow_start,rts,delivered,failed,delivered_per_sec\n", window_ms / 1000);
+    while (1) {
+        LogReader *earliest = NULL;
+        for (int i = 0; i < count; i++) {
+            if (readers[i].has_next && (!earliest || readers[i].next.timestamp_ms < earliest->next.timestamp_ms)) {
+                earliest = &readers[i];
+            }
+        }
+        if (!earliest) break;
+        handle_event(&earliest->next);
+        reader_advance(earliest);
+    }
+    flush_window();
+
+    // Статистика по парам узлов
+    unsigned long long total_success = 0, total_failure = 0, incomplete = 0;
+    printf("\n# Pairs\nsender,receiver,success,failure,success_ratio,mean_latency_ms\n");
+    for (int s = 0; s <= DACAP_MAX_ADDRESS; s++) {
+        for (int r = 0; r <= DACAP_MAX_ADDRESS; r++) {
+            PairStats *pair = &pairs[s][r];
+            incomplete += pair->open;
+            if (!pair->success && !pair->failure) continue;
+            printf("%d,%d,%u,%u,%.3f,%.1f\n", s, r, pair->success, pair->failure,
+                   (double)pair->success / (pair->success + pair->failure),
+                   pair->success ? (double)pair->latency_sum / pair->success : 0.0);
+            total_success += pair->success;
+            total_failure += pair->failure;
+        }
+    }
+
+    // Итоги и перцентили задержки RTS -> DELIVERED
+    printf("\n# Summary\n");
+    for (int i = 0; i < count; i++) {
+        printf("file %s: node %d, %llu lines%s\n", readers[i].path, readers[i].node, readers[i].lines,
+               readers[i].correlate ? "" : " (skipped: stats_ log present for node)");
+    }
+    printf("handshakes: %llu success, %llu failure (%llu before CTS, %llu after CTS), %llu incomplete, %llu orphan DELIVERED\n",
+           total_success, total_failure, failed_no_cts, failed_after_cts, incomplete, orphan_delivered);
+    if (latency_count) {
+        printf("latency ms: p50 %d, p90 %d, p99 %d, max %d\n",
+               latency_percentile(50.0), latency_percentile(90.0), latency_percentile(99.0), latency_percentile(100.0));
+    }
+
+    for (int i = 0; i < count; i++) {
+        fclose(readers[i].file);
+        free(readers[i].buffer);
+    }
+    free(readers);
+    return 0;
+}
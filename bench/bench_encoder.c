@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../dacap.h"
+
+// Сравнение кодировщика пакетов (dacap_encode_packet) с исходной реализацией
+// dacap_generate_packet на snprintf/sprintf. Перед замером проверяется, что оба
+// варианта формируют одинаковые строки; при расхождении программа завершается с кодом 1.
+
+#define DEFAULT_ITERATIONS 10000000L    // Количество кодирований на один замер
+#define DEST_MASK          15           // Адресаты 1..16 - как в серии msi к соседним узлам
+
+/// @brief Исходная реализация dacap_generate_packet (до кодировщика), эталон для сравнения
+/// Вызывающий затем считал длину строки через strlen, поэтому замер включает и его.
+static void reference_generate_packet(char *sendline, int dest_address, MessageType type, const char *data) {
+    const char *payload;    // Текст сообщения
+    int len;                // Длина сообщения
+    const char *ack;        // Флаг подтверждения доставки
+    char info_payload[30];  // Буфер для INFO;<data>
+
+    switch (type) {
+        case MSG_RTS:
+            payload = "RTS";
+            len = strlen(payload);
+            ack = "noack";
+            break;
+        case MSG_CTS:
+            payload = "CTS";
+            len = strlen(payload);
+            ack = "noack";
+            break;
+        case MSG_INFO:
+            snprintf(info_payload, sizeof(info_payload), "INFO;%s", data);
+            payload = info_payload;
+            len = strlen(payload);
+            ack = "ack";
+            break;
+        default:
+            sendline[0] = '\0';
+            return;
+    }
+    sprintf(sendline, "AT*SENDIM,%i,%i,%s,%s\n", len, dest_address, ack, payload);
+}
+
+/// @brief Проверка совпадения строк эталона и кодировщика
+/// @return - 0 при совпадении, -1 при расхождении
+static int check_equivalence(DacapEncoder *encoder) {
+    static const char *payloads[] = {"", "a", "Message 0", "payload longer than the twenty four character limit"};
+    static const MessageType types[] = {MSG_RTS, MSG_CTS, MSG_INFO};
+    char expected[DACAP_SENDLINE_SIZE], actual[DACAP_SENDLINE_SIZE];
+
+    for (int dest = -300; dest <= 100000; dest += dest < 300 ? 1 : 997) {
+        for (int t = 0; t < 3; t++) {
+            for (int p = 0; p < 4; p++) {
+                reference_generate_packet(expected, dest, types[t], payloads[p]);
+                int length = dacap_encode_packet(encoder, actual, sizeof(actual), dest, types[t], payloads[p]);
+                if (length != (int)strlen(expected) || strcmp(expected, actual) != 0) {
+                    fprintf(stderr, "Mismatch: dest=%d type=%d payload=\"%s\"\n  reference: %s  encoder:   %s",
+                            dest, types[t], payloads[p], expected, actual);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/// @brief Время в секундах для замеров
+static double seconds(void) {
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[]) {
+    static const MessageType types[] = {MSG_RTS, MSG_CTS, MSG_INFO};
+    static const char *names[] = {"RTS", "CTS", "INFO"};
+    static DacapEncoder encoder;    // Кэш строк слишком велик для стека
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    char sendline[DACAP_SENDLINE_SIZE];
+    char batch[4 * DACAP_SENDLINE_SIZE];
+    volatile size_t sink = 0;   // Не даёт компилятору выбросить кодирование
+    double start, reference_time, encoder_time;
+
+    if (iterations <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+    dacap_encoder_init(&encoder);
+    if (check_equivalence(&encoder) != 0) {
+        return 1;
+    }
+
+    printf("%-8s %16s %16s %8s\n", "frame", "reference M/s", "encoder M/s", "speedup");
+    for (int t = 0; t < 3; t++) {
+        start = seconds();
+        for (long i = 0; i < iterations; i++) {
+            reference_generate_packet(sendline, 1 + (int)(i & DEST_MASK), types[t], "Message 3");
+            sink += strlen(sendline);
+        }
+        reference_time = seconds() - start;
+
+        start = seconds();
+        for (long i = 0; i < iterations; i++) {
+            sink += (size_t)dacap_encode_packet(&encoder, sendline, sizeof(sendline), 1 + (int)(i & DEST_MASK), types[t], "Message 3");
+        }
+        encoder_time = seconds() - start;
+
+        printf("%-8s %16.1f %16.1f %7.1fx\n", names[t], iterations / reference_time / 1e6,
+               iterations / encoder_time / 1e6, reference_time / encoder_time);
+    }
+
+    // Ответ на принятый блок строк: CTS и INFO одним буфером (как в потоке чтения main.c)
+    start = seconds();
+    for (long i = 0; i < iterations; i++) {
+        size_t length;
+        reference_generate_packet(batch, 1 + (int)(i & DEST_MASK), MSG_CTS, NULL);
+        length = strlen(batch);
+        reference_generate_packet(batch + length, 2 + (int)(i & DEST_MASK), MSG_INFO, "Message 3");
+        sink += length + strlen(batch + length);
+    }
+    reference_time = seconds() - start;
+
+    start = seconds();
+    for (long i = 0; i < iterations; i++) {
+        DacapFrame frames[2] = {
+            {1 + (int)(i & DEST_MASK), MSG_CTS, NULL},
+            {2 + (int)(i & DEST_MASK), MSG_INFO, "Message 3"}
+        };
+        sink += (size_t)dacap_encode_frames(&encoder, batch, sizeof(batch), frames, 2);
+    }
+    encoder_time = seconds() - start;
+    printf("%-8s %16.1f %16.1f %7.1fx\n", "CTS+INFO", iterations / reference_time / 1e6,
+           iterations / encoder_time / 1e6, reference_time / encoder_time);
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+// Размеры буферов, таблиц и очередей клиента.
+// Любое значение можно переопределить при сборке, например -DJOURNAL_MAX_PENDING=128.
+// Профиль DACAP_EMBEDDED (-DDACAP_EMBEDDED) рассчитан на контроллер модема: все буферы
+// статические и уменьшены, журнал событий ведётся в кольцевом буфере в памяти.
+
+#ifdef DACAP_EMBEDDED
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE                 256     // Строки модема короче 100 символов
+#endif
+#ifndef DACAP_MAX_ADDRESS
+#define DACAP_MAX_ADDRESS           63      // Кэш RTS/CTS: 2 x 64 x 32 байта на кодировщик
+#endif
+#ifndef JOURNAL_MAX_PENDING
+#define JOURNAL_MAX_PENDING         64
+#endif
+#ifndef JOURNAL_BUFFER_SIZE
+#define JOURNAL_BUFFER_SIZE         4096
+#endif
+#ifndef JOURNAL_SEGMENT_SIZE
+#define JOURNAL_SEGMENT_SIZE        (64L * 1024)
+#endif
+#ifndef TRACE_STATS_MAX_LATENCY_MS
+#define TRACE_STATS_MAX_LATENCY_MS  (2 * TIMEOUT_MS)    // Задержка RTS -> DELIVERED не превышает двух таймаутов
+#endif
+#ifndef CONSOLE_LINE_SIZE
+#define CONSOLE_LINE_SIZE           128
+#endif
+#ifndef STACK_PAINT_SIZE
+#define STACK_PAINT_SIZE            16384   // Область стека потока для замера наибольшей глубины (0 - без замера)
+#endif
+
+#endif
+
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE                 1024    // Размер принимаемого пакета
+#endif
+#ifndef TIMEOUT_MS
+#define TIMEOUT_MS                  2000    // Время ожидания между передачами
+#endif
+#ifndef SEND_MAX_ATTEMPTS
+#define SEND_MAX_ATTEMPTS           3       // Попыток отправки журналируемого сообщения за один сеанс
+#endif
+#ifndef SEND_ABANDON_ATTEMPTS
+#define SEND_ABANDON_ATTEMPTS       0       // Попыток, после которых сообщение снимается с отправки навсегда (0 - не снимается)
+#endif
+#ifndef DACAP_MAX_ADDRESS
+#define DACAP_MAX_ADDRESS           255     // Максимальный адрес узла, для которого кэшируются служебные пакеты
+#endif
+#ifndef JOURNAL_MAX_PENDING
+#define JOURNAL_MAX_PENDING         1024    // Максимальное количество неподтверждённых сообщений
+#endif
+#ifndef JOURNAL_BUFFER_SIZE
+#define JOURNAL_BUFFER_SIZE         65536   // Размер буфера накопления одной пачки записей
+#endif
+#ifndef JOURNAL_SEGMENT_SIZE
+#define JOURNAL_SEGMENT_SIZE        (1L << 20)  // Размер сегмента, после которого он перерабатывается
+#endif
+#ifndef JOURNAL_BATCH_WINDOW_MS
+#define JOURNAL_BATCH_WINDOW_MS     5       // Окно группового сброса на диск
+#endif
+#ifndef TRACE_STATS_MAX_LATENCY_MS
+#define TRACE_STATS_MAX_LATENCY_MS  10000   // Верхняя граница гистограммы задержек (всё, что выше, попадает в последний интервал)
+#endif
+#ifndef CONSOLE_LINE_SIZE
+#define CONSOLE_LINE_SIZE           (BUFFER_SIZE + 32)  // Строка консоли вмещает принятый пакет целиком
+#endif
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE               16384   // Кольцевой журнал событий профиля DACAP_EMBEDDED
+#endif
+#ifndef LOG_LINE_SIZE
+#define LOG_LINE_SIZE               192     // Максимальная длина строки кольцевого журнала
+#endif
+
+#endif
@@ -1,89 +1,192 @@
 #include <stdio.h>
 #include <string.h>
 #include "dacap.h"
+#include "embedded.h"
 
 
+/// @brief Запись целого числа в десятичном виде без обращения к printf
+/// @param p        - позиция записи
+/// @param value    - число
+/// @return         - позиция после записанного числа
+static char *put_int(char *p, int value) {
+    char digits[12];
+    int n = 0;
+    unsigned int v = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+
+    if (value < 0) {
+        *p++ = '-';
+    }
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+/// @brief Сборка строки AT*SENDIM без проверок размера (буфер должен вмещать строку целиком)
+/// @param p            - позиция записи
+/// @param dest_address - адресат
+/// @param type         - тип сообщения
+/// @param data         - полезные данные (только для INFO)
+/// @return             - позиция после символа перевода строки
+static char *put_sendim(char *p, int dest_address, MessageType type, const char *data) {
+    size_t data_len = 0;
+
+    memcpy(p, "AT*SENDIM,", 10);
+    p += 10;
+    if (type == MSG_INFO) {
+        // Длина INFO;<data> с тем же ограничением, что и у исходного формата
+        if (data) {
+            while (data_len < DACAP_INFO_DATA_MAX && data[data_len] != '\0') {
+                data_len++;
+            }
+        }
+        p = put_int(p, (int)data_len + 5);
+        *p++ = ',';
+        p = put_int(p, dest_address);
+        memcpy(p, ",ack,INFO;", 10);
+        p += 10;
+        if (data_len) {
+            memcpy(p, data, data_len);
+            p += data_len;
+        }
+    } else {
+        memcpy(p, "3,", 2);
+        p += 2;
+        p = put_int(p, dest_address);
+        memcpy(p, type == MSG_RTS ? ",noack,RTS" : ",noack,CTS", 10);
+        p += 10;
+    }
+    *p++ = '\n';
+    return p;
+}
+
 void dacap_generate_packet(char *sendline, int dest_address, MessageType type, const char *data) {
-    const char *payload;    // Текст сообщения
-    int len;                // Длина сообщения
-    const char *ack;        // Флаг подтверждения доставки
-    
-    // Выбор типа генерируемого пакета
-    switch (type) {
-        // Формироваение запроса на отправку
-        case MSG_RTS:
-            payload = "RTS";
-            len = strlen(payload);
-            ack = "noack";
-            break;
-        // Формирование разрешения на отправку
-        case MSG_CTS:
-            payload = "CTS";
-            len = strlen(payload);
-            ack = "noack";
-            break;
-        // Формирование информационного пакета
-        case MSG_INFO:
-            char info_payload[30]; // Буфер для INFO;<data>
-            snprintf(info_payload, sizeof(info_payload), "INFO;%s", data);
-            payload = info_payload;
-            len = strlen(payload);
-            ack = "ack";
-            break;
-        // Возврат пустой строки, если тип сообщения неизвестен
-        default:
-            sendline[0] = '\0';
-            return;
+    if (dacap_encode_packet(NULL, sendline, DACAP_SENDLINE_SIZE, dest_address, type, data) < 0) {
+        sendline[0] = '\0';
     }
-    // Итоговая сборка строки
-    sprintf(sendline, "AT*SENDIM,%i,%i,%s,%s\n", len, dest_address, ack, payload);
 }
 
-int dacap_parse_packet(char *buffer, Packet *packet) {
-    char chunks[1024][20];          // Выделение буффера для хранения фрагментов строки 
-    int i = 0;                      // Итератор подстрок в строке
-    char *dup = strdup(buffer);     // Копия строки, чтобы не изменять исходную 
-    char *chunk = strtok(dup, ","); // Выделение первой подстроки по разделителю
-    
-    while (chunk && i < 1024) {
-        strncpy(chunks[i], chunk, 19);
-        chunks[i][19] = '\0';
-        i++;
-        chunk = strtok(NULL, ",");
+void dacap_encoder_init(DacapEncoder *encoder) {
+    memset(encoder->rts_len, 0, sizeof(encoder->rts_len));
+    memset(encoder->cts_len, 0, sizeof(encoder->cts_len));
+}
+
+int dacap_encode_packet(DacapEncoder *encoder, char *buffer, size_t size, int dest_address, MessageType type, const char *data) {
+    char line[DACAP_SENDLINE_SIZE];   // Промежуточный буфер на случай нехватки места у вызывающего
+    int len;
+
+    if (type != MSG_RTS && type != MSG_CTS && type != MSG_INFO) {
+        return -1;
+    }
+
+    // Служебные пакеты берутся из кэша по адресу назначения
+    if (encoder && type != MSG_INFO && dest_address >= 0 && dest_address <= DACAP_MAX_ADDRESS) {
+        unsigned char *cached_len = type == MSG_RTS ? &encoder->rts_len[dest_address] : &encoder->cts_len[dest_address];
+        char *cached = type == MSG_RTS ? encoder->rts[dest_address] : encoder->cts[dest_address];
+        if (*cached_len == 0) {
+            *cached_len = (unsigned char)(put_sendim(cached, dest_address, type, NULL) - cached);
+        }
+        len = *cached_len;
+        if ((size_t)len + 1 > size) {
+            return -1;
+        }
+        memcpy(buffer, cached, len);
+        buffer[len] = '\0';
+        return len;
     }
-    
-    free(dup);  // Освобождение ресурсов после выполнения разбиения на подстроки
 
+    // Строка максимальной длины заведомо меньше DACAP_SENDLINE_SIZE,
+    // поэтому при достаточном буфере запись идёт напрямую
+    if (size >= DACAP_SENDLINE_SIZE) {
+        len = (int)(put_sendim(buffer, dest_address, type, data) - buffer);
+        buffer[len] = '\0';
+        return len;
+    }
+    len = (int)(put_sendim(line, dest_address, type, data) - line);
+    if ((size_t)len + 1 > size) {
+        return -1;
+    }
+    memcpy(buffer, line, len);
+    buffer[len] = '\0';
+    return len;
+}
+
+int dacap_encode_frames(DacapEncoder *encoder, char *buffer, size_t size, const DacapFrame *frames, int count) {
+    size_t total = 0;
+
+    // Кадры пишутся друг за другом, каждый следующий затирает завершающий ноль предыдущего
+    for (int i = 0; i < count; i++) {
+        int len = dacap_encode_packet(encoder, buffer + total, size - total, frames[i].dest, frames[i].type, frames[i].data);
+        if (len < 0) {
+            if (size > 0) {
+                buffer[0] = '\0';
+            }
+            return -1;
+        }
+        total += len;
+    }
+    if (count == 0 && size > 0) {
+        buffer[0] = '\0';
+    }
+    return (int)total;
+}
+
+int dacap_parse_packet(char *buffer, Packet *packet) {
+    const char *fields[DACAP_PARSE_FIELDS];  // Начала используемых полей строки (без копирования)
+    size_t lengths[DACAP_PARSE_FIELDS];      // Длины полей
+    int i = 0;                               // Количество непустых полей
+    const char *p = buffer;
+
+    // Разбиение по запятым на месте: пустые поля пропускаются, как при разборе strtok,
+    // а каждое поле ограничено DACAP_FIELD_SIZE - 1 символами
+    while (*p && i < DACAP_PARSE_FIELDS) {
+        const char *start = p;
+        while (*p && *p != ',') p++;
+        if (p > start) {
+            size_t length = (size_t)(p - start);
+            fields[i] = start;
+            lengths[i] = length < DACAP_FIELD_SIZE - 1 ? length : DACAP_FIELD_SIZE - 1;
+            i++;
+        }
+        if (*p == ',') p++;
+    }
     // Инциализация пакета по умолчанию
     packet->src = 0;
     packet->dest = 0;
     packet->payload[0] = '\0';
 
     // Анализ пакета по его содержимому и запись параметров в структуру
-    if (strcmp(chunks[0], "RECVIM") == 0 && i >= 10) {
-        packet->src = atoi(chunks[2]);      
-        packet->dest = atoi(chunks[3]);
-        if (strncmp(chunks[9], "RTS", 3) == 0) {
+    if (i >= 10 && lengths[0] == 6 && memcmp(fields[0], "RECVIM", 6) == 0) {
+        packet->src = atoi(fields[2]);
+        packet->dest = atoi(fields[3]);
+        if (lengths[9] >= 3 && memcmp(fields[9], "RTS", 3) == 0) {
             packet->type = MSG_RTS;
             strcpy(packet->payload, "RTS");
-        } else if (strncmp(chunks[9], "CTS", 3) == 0) {
+        } else if (lengths[9] >= 3 && memcmp(fields[9], "CTS", 3) == 0) {
             packet->type = MSG_CTS;
             strcpy(packet->payload, "CTS");
-        } else if (strncmp(chunks[9], "INFO;", 5) == 0) {
+        } else if (lengths[9] >= 5 && memcmp(fields[9], "INFO;", 5) == 0) {
+            size_t length = lengths[9] - 5;
             packet->type = MSG_INFO;
-            strncpy(packet->payload, chunks[9] + 5, sizeof(packet->payload) - 1);
-            packet->payload[sizeof(packet->payload) - 1] = '\0';
-            char *end = packet->payload + strlen(packet->payload) - 1;
-            while (end >= packet->payload && (*end == '\r' || *end == '\n')) {
-                *end = '\0';
-                end--;
+            if (length > sizeof(packet->payload) - 1) {
+                length = sizeof(packet->payload) - 1;
+            }
+            memcpy(packet->payload, fields[9] + 5, length);
+            // Отбрасывание завершающих символов перевода строки
+            while (length > 0 && (packet->payload[length - 1] == '\r' || packet->payload[length - 1] == '\n')) {
+                length--;
             }
+            packet->payload[length] = '\0';
         } else {
             return -1;
         }
-    } else if (strncmp(chunks[0], "DELIVERED", 9) == 0 && i >= 2) {
+    } else if (i >= 2 && lengths[0] >= 9 && memcmp(fields[0], "DELIVERED", 9) == 0) {
         packet->type = MSG_DELIVERED;
-        packet->dest = atoi(chunks[1]);
+        packet->dest = atoi(fields[1]);
         packet->src = packet->dest;
         packet->payload[0] = '\0';
     } else {
@@ -92,8 +195,8 @@ int dacap_parse_packet(char *buffer, Packet *packet) {
     return 0; // Успех
 }
 
-DacapResult dacap_send(int my_address, int dest_address, const char *message, Logger *logger) {
-    DacapResult result = {0, MSG_RTS, {0}}; // Инициализация структуры результата
+DacapResult dacap_send(int my_address, int dest_address, const char *message, Logger *logger, DacapEncoder *encoder) {
+    DacapResult result = {0, MSG_RTS, {0}, 0}; // Инициализация структуры результата
     char log_buffer[100];
 
     // Проверяем, что адрес получателя валидный
@@ -105,15 +208,15 @@ DacapResult dacap_send(int my_address, int dest_address, const char *message, Lo
     }
 
     // Формирование пакета RTS как стартового в алгоритме
-    dacap_generate_packet(result.sendline, dest_address, MSG_RTS, message);
+    result.length = dacap_encode_packet(encoder, result.sendline, sizeof(result.sendline), dest_address, MSG_RTS, message);
     snprintf(log_buffer, sizeof(log_buffer), "Prepared RTS to %d", dest_address);
     log_details(logger, log_buffer);
     result.type = MSG_RTS;
     return result;
 }
 
-DacapResult dacap_handle_packet(Packet *packet, int my_address, Logger *logger) {
-    DacapResult result = {1, MSG_RTS, {0}}; // Инициализация структуры по умолчанию
+DacapResult dacap_handle_packet(Packet *packet, int my_address, Logger *logger, DacapEncoder *encoder) {
+    DacapResult result = {1, MSG_RTS, {0}, 0}; // Инициализация структуры по умолчанию
     char log_buffer[100];
 
     // Логирование информации о пакете
@@ -133,7 +236,7 @@ DacapResult dacap_handle_packet(Packet *packet, int my_address, Logger *logger)
         case MSG_RTS:
             snprintf(log_buffer, sizeof(log_buffer), "RTS from %d", packet->src);
             log_details(logger, log_buffer);
-            dacap_generate_packet(result.sendline, packet->src, MSG_CTS, NULL);
+            result.length = dacap_encode_packet(encoder, result.sendline, sizeof(result.sendline), packet->src, MSG_CTS, NULL);
             snprintf(log_buffer, sizeof(log_buffer), "Prepared CTS for %d", packet->src);
             log_details(logger, log_buffer);
             result.status = 0;
@@ -150,7 +253,6 @@ DacapResult dacap_handle_packet(Packet *packet, int my_address, Logger *logger)
         case MSG_INFO:
             snprintf(log_buffer, sizeof(log_buffer), "INFO from %d: %s", packet->src, packet->payload);
             log_details(logger, log_buffer);
-            printf("Message from %d: %s\n", packet->src, packet->payload);
             result.status = 0;
             result.type = MSG_INFO;
             break;
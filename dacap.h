@@ -2,8 +2,15 @@
 #define DACAP_H
 
 #include <stdlib.h>
+#include "config.h"
 #include "logger/logger.h"
 
+#define DACAP_SENDLINE_SIZE  100 // Размер строки для отправки
+#define DACAP_CTRL_LINE_SIZE 32  // Размер буфера под строку RTS/CTS
+#define DACAP_INFO_DATA_MAX  24  // Максимальная длина полезных данных INFO (INFO;<data> не длиннее 29 символов)
+#define DACAP_PARSE_FIELDS   10  // Количество полей входящей строки, используемых при разборе
+#define DACAP_FIELD_SIZE     20  // Поле входящей строки ограничено DACAP_FIELD_SIZE - 1 символами
+
 
 /// Виды сообщений в рамках протокола 
 typedef enum { 
@@ -25,9 +32,27 @@ typedef struct {
 typedef struct {
     int status;         // Результат: 0 - успех, -1 - ошибка, 1 - пропуск сообщения
     MessageType type;   // Тип сформированного пакета (RTS, CTS, INFO)
-    char sendline[100]; // Строка для отправки
+    char sendline[DACAP_SENDLINE_SIZE]; // Строка для отправки
+    int length;         // Длина строки для отправки (без завершающего нуля)
 } DacapResult;
 
+/// @brief Кэш заранее сформированных строк RTS/CTS по адресам назначения
+/// Строки зависят только от адреса, поэтому формируются один раз при первом обращении.
+/// Объект не потокобезопасен: каждому потоку нужен свой кодировщик.
+typedef struct {
+    unsigned char rts_len[DACAP_MAX_ADDRESS + 1];               // Длины строк RTS (0 - ещё не сформирована)
+    unsigned char cts_len[DACAP_MAX_ADDRESS + 1];               // Длины строк CTS (0 - ещё не сформирована)
+    char rts[DACAP_MAX_ADDRESS + 1][DACAP_CTRL_LINE_SIZE];      // Строки RTS
+    char cts[DACAP_MAX_ADDRESS + 1][DACAP_CTRL_LINE_SIZE];      // Строки CTS
+} DacapEncoder;
+
+/// @brief Описание одного кадра для пакетного кодирования
+typedef struct {
+    int dest;           // Адресат
+    MessageType type;   // Тип сообщения
+    const char *data;   // Полезные данные (только для INFO)
+} DacapFrame;
+
 /// @brief Функция для генерации пакета
 /// @param sendline         - строка для отправки
 /// @param dest_address     - адресат (кому отправляем)
@@ -35,6 +60,29 @@ typedef struct {
 /// @param data             - полезные данные
 void dacap_generate_packet(char *sendline, int dest_address, MessageType type, const char *data);
 
+/// @brief Функция инициализации кодировщика пакетов
+/// @param encoder  - объект кодировщика
+void dacap_encoder_init(DacapEncoder *encoder);
+
+/// @brief Функция кодирования пакета напрямую в буфер вызывающего
+/// @param encoder      - кодировщик с кэшем RTS/CTS (может быть NULL - без кэширования)
+/// @param buffer       - буфер для записи
+/// @param size         - размер буфера
+/// @param dest_address - адресат (кому отправляем)
+/// @param type         - тип передаваемого сообщения
+/// @param data         - полезные данные
+/// @return             - длина записанной строки без завершающего нуля, -1 при ошибке или нехватке места
+int dacap_encode_packet(DacapEncoder *encoder, char *buffer, size_t size, int dest_address, MessageType type, const char *data);
+
+/// @brief Функция кодирования нескольких кадров подряд в один буфер (для одного send)
+/// @param encoder  - кодировщик с кэшем RTS/CTS (может быть NULL)
+/// @param buffer   - буфер для записи
+/// @param size     - размер буфера
+/// @param frames   - массив кадров
+/// @param count    - количество кадров
+/// @return         - суммарная длина записанных кадров, -1 при ошибке или нехватке места
+int dacap_encode_frames(DacapEncoder *encoder, char *buffer, size_t size, const DacapFrame *frames, int count);
+
 /// @brief Функция анализа входящих пакетов
 /// @param buffer   - пришедшая строка
 /// @param packet   - структура для разбора пакета
@@ -46,14 +94,16 @@ int dacap_parse_packet(char *buffer, Packet *packet);
 /// @param dest_address - адрес узла-принимающего
 /// @param message      - передаваемое сообщение
 /// @param logger       - объект логгера
+/// @param encoder      - кодировщик пакетов вызывающего потока (может быть NULL)
 /// @return             - структура с результатом отправки
-DacapResult dacap_send(int my_address, int dest_address, const char *message, Logger *logger);
+DacapResult dacap_send(int my_address, int dest_address, const char *message, Logger *logger, DacapEncoder *encoder);
 
 /// @brief Функция для обработки входящих сообщений и принятия решений о дальнейших действиях протоколов
 /// @param packet       - структура для хранения данных о пакете
 /// @param my_address   - гидроакустический адрес текущего узла
 /// @param logger       - объект логгера
+/// @param encoder      - кодировщик пакетов вызывающего потока (может быть NULL)
 /// @return             - структура с результатом отправки
-DacapResult dacap_handle_packet(Packet *packet, int my_address, Logger *logger);
+DacapResult dacap_handle_packet(Packet *packet, int my_address, Logger *logger, DacapEncoder *encoder);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef EMBEDDED_H
+#define EMBEDDED_H
+
+#include <stddef.h>
+#include "config.h"
+
+// Подключается последним в каждом исходном файле клиента.
+// В профиле DACAP_EMBEDDED обращение к динамической памяти после этой точки - ошибка компиляции.
+// Это ловит только вызовы в коде клиента; выделения внутри библиотеки C (буфер stdout, perror)
+// проверяет тест tests/alloc_test.c.
+#ifdef DACAP_EMBEDDED
+#pragma GCC poison malloc calloc realloc free strdup strndup
+#endif
+
+// Замер наибольшей глубины стека потока (профиль DACAP_EMBEDDED).
+// STACK_PAINT() в начале потока заполняет образцом STACK_PAINT_SIZE байт под кадром функции потока,
+// STACK_HIGH_WATER() в конце потока возвращает, сколько из них было затёрто - с кадрами
+// библиотеки C и Win32 API. Оба макроса вызываются из самой функции потока, на одной глубине.
+#if defined(DACAP_EMBEDDED) && STACK_PAINT_SIZE > 0
+
+#define STACK_PAINT_BYTE 0xA5
+
+/// @brief Заполнение образцом области стека под кадром вызывающей функции
+static __attribute__((noinline, unused)) void stack_paint(void) {
+    volatile unsigned char area[STACK_PAINT_SIZE];
+    for (size_t i = 0; i < sizeof(area); i++) {
+        area[i] = STACK_PAINT_BYTE;
+    }
+}
+
+/// @brief Объём стека под кадром вызывающей функции, затёртый с момента stack_paint
+/// Область читается из того же места стека, что и при заполнении: кадры функций совпадают.
+/// @return - байт
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+static __attribute__((noinline, unused)) int stack_high_water(void) {
+    volatile unsigned char area[STACK_PAINT_SIZE];
+    size_t i = 0;
+    // Стек растёт вниз: начало массива - самая глубокая часть области
+    while (i < sizeof(area) && area[i] == STACK_PAINT_BYTE) {
+        i++;
+    }
+    return (int)(sizeof(area) - i);
+}
+#pragma GCC diagnostic pop
+
+#define STACK_PAINT()       stack_paint()
+#define STACK_HIGH_WATER()  stack_high_water()
+#else
+#define STACK_PAINT()       ((void)0)
+#define STACK_HIGH_WATER()  0
+#endif
+
+#endif
@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <string.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <windows.h>
+#include "journal.h"
+#include "../embedded.h"
+
+// Формат записи: <тип:1 байт><поля><контрольная сумма FNV-1a:4 байта>
+//   'H' <поколение:4>                  - заголовок сегмента
+//   'A' <номер:4><адрес:4><длина:1><текст> - сообщение поставлено в очередь
+//   'D' <номер:4>                      - сообщение доставлено
+//   'X' <номер:4>                      - сообщение снято с отправки после неудачных попыток
+//   'C' <поколение:4>                  - снимок неподтверждённых сообщений записан полностью
+// Числа хранятся в порядке little-endian. Чтение сегмента останавливается на первой
+// повреждённой записи: это недописанный хвост пачки при падении.
+#define RECORD_HEADER     'H'
+#define RECORD_APPEND     'A'
+#define RECORD_DELIVERED  'D'
+#define RECORD_ABANDONED  'X'
+#define RECORD_CHECKPOINT 'C'
+#define SIMPLE_RECORD_SIZE 9                                // Тип + число + контрольная сумма
+#define APPEND_RECORD_MAX  (14 + JOURNAL_MESSAGE_SIZE)      // Максимальный размер записи 'A'
+
+/// @brief Контрольная сумма FNV-1a
+static unsigned long checksum(const unsigned char *p, size_t length) {
+    unsigned long hash = 2166136261UL;
+    for (size_t i = 0; i < length; i++) {
+        hash = ((hash ^ p[i]) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+static void put_u32(unsigned char *p, unsigned long value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static unsigned long get_u32(const unsigned char *p) {
+    return (unsigned long)p[0] | (unsigned long)p[1] << 8 | (unsigned long)p[2] << 16 | (unsigned long)p[3] << 24;
+}
+
+/// @brief Кодирование записи из одного числа ('H', 'D', 'C')
+/// @return - размер записи
+static size_t encode_simple(unsigned char *p, char type, unsigned long value) {
+    p[0] = (unsigned char)type;
+    put_u32(p + 1, value);
+    put_u32(p + 5, checksum(p, 5));
+    return SIMPLE_RECORD_SIZE;
+}
+
+/// @brief Кодирование записи о постановке сообщения в очередь
+/// @return - размер записи
+static size_t encode_append(unsigned char *p, const JournalEntry *entry) {
+    size_t length = strnlen(entry->message, JOURNAL_MESSAGE_SIZE - 1);
+    p[0] = RECORD_APPEND;
+    put_u32(p + 1, entry->seq);
+    put_u32(p + 5, (unsigned long)entry->dest_address);
+    p[9] = (unsigned char)length;
+    memcpy(p + 10, entry->message, length);
+    put_u32(p + 10 + length, checksum(p, 10 + length));
+    return 14 + length;
+}
+
+/// @brief Запись буфера в файл целиком
+static int write_all(int fd, const void *data, size_t length) {
+    const char *p = data;
+    while (length > 0) {
+        int written = _write(fd, p, (unsigned int)length);
+        if (written <= 0) return -1;
+        p += written;
+        length -= (size_t)written;
+    }
+    return 0;
+}
+
+/// @brief Поиск неподтверждённого сообщения по номеру
+/// @return - индекс в массиве pending или -1
+static int find_pending(const Journal *journal, unsigned long seq) {
+    for (int i = 0; i < journal->pending_count; i++) {
+        if (journal->pending[i].seq == seq) return i;
+    }
+    return -1;
+}
+
+static void remove_pending(Journal *journal, int index) {
+    journal->pending_count--;
+    memmove(&journal->pending[index], &journal->pending[index + 1],
+            (size_t)(journal->pending_count - index) * sizeof(JournalEntry));
+}
+
+/// @brief Чтение сегмента
+/// @param path         - путь к сегменту
+/// @param journal      - журнал для восстановления сообщений (NULL - только проверка)
+/// @param generation   - поколение сегмента
+/// @param max_seq      - наибольший номер записи в сегменте
+/// @return             - 1, если снимок в сегменте записан полностью, иначе 0
+static int read_segment(const char *path, Journal *journal, unsigned long *generation, unsigned long *max_seq) {
+    unsigned char record[APPEND_RECORD_MAX];
+    int complete = 0;
+    int type;
+    FILE *file = fopen(path, "rb");
+
+    *generation = 0;
+    *max_seq = 0;
+    if (!file) return 0;
+
+    while ((type = fgetc(file)) != EOF) {
+        size_t length;
+        record[0] = (unsigned char)type;
+        if (type == RECORD_APPEND) {
+            if (fread(record + 1, 1, 9, file) != 9 || record[9] >= JOURNAL_MESSAGE_SIZE) break;
+            length = 14 + record[9];
+            if (fread(record + 10, 1, length - 10, file) != length - 10) break;
+        } else if (type == RECORD_HEADER || type == RECORD_DELIVERED || type == RECORD_ABANDONED || type == RECORD_CHECKPOINT) {
+            length = SIMPLE_RECORD_SIZE;
+            if (fread(record + 1, 1, length - 1, file) != length - 1) break;
+        } else {
+            break;
+        }
+        if (get_u32(record + length - 4) != checksum(record, length - 4)) break;
+
+        unsigned long value = get_u32(record + 1);
+        if (type == RECORD_HEADER) {
+            *generation = value;
+        } else if (type == RECORD_CHECKPOINT) {
+            complete = value == *generation;
+        } else {
+            if (value > *max_seq) *max_seq = value;
+            if (!journal) continue;
+            int index = find_pending(journal, value);
+            if (type == RECORD_DELIVERED || type == RECORD_ABANDONED) {
+                if (index >= 0) remove_pending(journal, index);
+            } else if (index < 0 && journal->pending_count < JOURNAL_MAX_PENDING) {
+                // Сообщение может встретиться дважды: в снимке и в пачке, записанной после смены сегмента
+                JournalEntry *entry = &journal->pending[journal->pending_count++];
+                entry->seq = value;
+                entry->dest_address = (int)get_u32(record + 5);
+                memcpy(entry->message, record + 10, record[9]);
+                entry->message[record[9]] = '\0';
+            }
+        }
+    }
+    fclose(file);
+    return complete;
+}
+
+/// @brief Смена сегмента: снимок неподтверждённых сообщений пишется в начало второго сегмента
+/// Вызывается под блокировкой журнала, когда буфер пачки (не заполняемый) свободен:
+/// снимок собирается в нём, а не на стеке.
+/// @return - 0 при успехе, -1 при ошибке
+static int roll_segment(Journal *journal) {
+    unsigned char *chunk = (unsigned char *)journal->buffer[1 - journal->fill];
+    size_t used = 0;
+    long total = 0;
+    int next = 1 - journal->segment;
+    unsigned long generation = journal->generation + 1;
+    int fd = _open(journal->path[next], _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    if (fd < 0) return -1;
+
+    used += encode_simple(chunk, RECORD_HEADER, generation);
+    for (int i = 0; i < journal->pending_count; i++) {
+        // Место оставляется и под запись, и под завершающую отметку снимка
+        if (used + APPEND_RECORD_MAX + SIMPLE_RECORD_SIZE > JOURNAL_BUFFER_SIZE) {
+            if (write_all(fd, chunk, used) != 0) goto fail;
+            total += (long)used;
+            used = 0;
+        }
+        used += encode_append(chunk + used, &journal->pending[i]);
+    }
+    used += encode_simple(chunk + used, RECORD_CHECKPOINT, generation);
+    if (write_all(fd, chunk, used) != 0) goto fail;
+    total += (long)used;
+    if (journal->durability >= JOURNAL_DURABILITY_GROUP && _commit(fd) != 0) goto fail;
+
+    // Старый сегмент остаётся на диске до следующей смены как запасной
+    if (journal->fd >= 0) {
+        _close(journal->fd);
+    }
+    journal->fd = fd;
+    journal->segment = next;
+    journal->generation = generation;
+    journal->segment_bytes = total;
+    return 0;
+
+fail:
+    _close(fd);
+    return -1;
+}
+
+/// @brief Поток группового сброса: одна запись и один _commit на накопленную пачку
+static DWORD WINAPI journal_flusher(LPVOID param) {
+    Journal *journal = (Journal *)param;
+
+    STACK_PAINT();
+    EnterCriticalSection(&journal->lock);
+    while (1) {
+        while (!journal->stop && journal->fill_len == 0) {
+            SleepConditionVariableCS(&journal->has_work, &journal->lock, INFINITE);
+        }
+        if (journal->fill_len == 0) {
+            break;  // Остановка, всё записано
+        }
+        if (journal->durability == JOURNAL_DURABILITY_GROUP && !journal->stop && journal->fill_len < JOURNAL_BUFFER_SIZE / 2) {
+            // Окно накопления: записи, пришедшие за это время, попадут в ту же пачку
+            LeaveCriticalSection(&journal->lock);
+            Sleep(JOURNAL_BATCH_WINDOW_MS);
+            EnterCriticalSection(&journal->lock);
+        }
+
+        // Смена буферов: пока пачка пишется, новые записи идут во второй буфер
+        int batch = journal->fill;
+        size_t length = journal->fill_len;
+        unsigned long last_seq = journal->appended_seq;
+        journal->fill = 1 - batch;
+        journal->fill_len = 0;
+        LeaveCriticalSection(&journal->lock);
+
+        int ok = write_all(journal->fd, journal->buffer[batch], length) == 0 &&
+                 (journal->durability < JOURNAL_DURABILITY_GROUP || _commit(journal->fd) == 0);
+
+        EnterCriticalSection(&journal->lock);
+        if (ok) {
+            journal->segment_bytes += (long)length;
+            journal->committed_seq = last_seq;
+            if (journal->segment_bytes >= JOURNAL_SEGMENT_SIZE && roll_segment(journal) != 0) {
+                ok = 0;
+            }
+        }
+        if (!ok) {
+            journal->io_error = 1;
+#ifndef DACAP_EMBEDDED
+            // Во встраиваемом профиле ошибка видна по journal_append: perror в небуферизованный
+            // stderr занимает в стеке потока около 8 КБ
+            perror("Journal write failed");
+#endif
+        }
+        WakeAllConditionVariable(&journal->committed);
+    }
+    journal->stack_used = STACK_HIGH_WATER();
+    LeaveCriticalSection(&journal->lock);
+    return 0;
+}
+
+/// @brief Добавление записи в заполняемый буфер (под блокировкой)
+/// @return - 0 при успехе, -1 при ошибке записи журнала
+static int buffer_record(Journal *journal, const unsigned char *record, size_t length) {
+    // Буфер заполнен: ожидание, пока поток сброса заберёт его
+    while (!journal->io_error && journal->fill_len + length > JOURNAL_BUFFER_SIZE) {
+        WakeConditionVariable(&journal->has_work);
+        SleepConditionVariableCS(&journal->committed, &journal->lock, INFINITE);
+    }
+    if (journal->io_error) return -1;
+    memcpy(journal->buffer[journal->fill] + journal->fill_len, record, length);
+    journal->fill_len += length;
+    WakeConditionVariable(&journal->has_work);
+    return 0;
+}
+
+int journal_open(Journal *journal, const char *prefix, JournalDurability durability) {
+    unsigned long generation[2], max_seq[2];
+    int complete[2];
+    int base = -1;
+
+    memset(journal, 0, sizeof(*journal));
+    journal->durability = durability;
+    journal->fd = -1;
+    journal->next_seq = 1;
+    if (durability == JOURNAL_DURABILITY_NONE) {
+        return 0;
+    }
+
+    // Выбор сегмента с полным снимком и наибольшим поколением
+    for (int i = 0; i < 2; i++) {
+        snprintf(journal->path[i], sizeof(journal->path[i]), "%s.%d", prefix, i);
+        complete[i] = read_segment(journal->path[i], NULL, &generation[i], &max_seq[i]);
+        if (complete[i] && (base < 0 || generation[i] > generation[base])) {
+            base = i;
+        }
+    }
+    if (base >= 0) {
+        read_segment(journal->path[base], journal, &generation[base], &max_seq[base]);
+        journal->segment = base;
+        journal->generation = generation[base];
+        journal->next_seq = (max_seq[0] > max_seq[1] ? max_seq[0] : max_seq[1]) + 1;
+    } else {
+        journal->segment = 1;  // Первый снимок будет записан в сегмент 0
+    }
+    journal->appended_seq = journal->next_seq - 1;
+    journal->committed_seq = journal->appended_seq;
+
+    // Восстановленные сообщения сразу переписываются в чистый сегмент без повреждённого хвоста
+    if (roll_segment(journal) != 0) {
+        perror("Failed to open journal segment");
+        return -1;
+    }
+
+    InitializeCriticalSection(&journal->lock);
+    InitializeConditionVariable(&journal->has_work);
+    InitializeConditionVariable(&journal->committed);
+    journal->flusher = CreateThread(NULL, 0, journal_flusher, journal, 0, NULL);
+    if (!journal->flusher) {
+        _close(journal->fd);
+        journal->fd = -1;
+        DeleteCriticalSection(&journal->lock);
+        return -1;
+    }
+    return journal->pending_count;
+}
+
+unsigned long journal_append(Journal *journal, int dest_address, const char *message) {
+    unsigned char record[APPEND_RECORD_MAX];
+    unsigned long seq = 0;
+
+    if (!journal->flusher) return 0;
+
+    EnterCriticalSection(&journal->lock);
+    if (journal->pending_count < JOURNAL_MAX_PENDING && !journal->io_error) {
+        JournalEntry *entry = &journal->pending[journal->pending_count];
+        entry->seq = journal->next_seq;
+        entry->dest_address = dest_address;
+        strncpy(entry->message, message, sizeof(entry->message) - 1);
+        entry->message[sizeof(entry->message) - 1] = '\0';
+        if (buffer_record(journal, record, encode_append(record, entry)) == 0) {
+            seq = journal->next_seq++;
+            journal->appended_seq = seq;
+            journal->pending_count++;
+        }
+    }
+    LeaveCriticalSection(&journal->lock);
+    return seq;
+}
+
+int journal_wait(Journal *journal, unsigned long seq) {
+    int result;
+
+    if (!journal->flusher || seq == 0) return 0;
+
+    EnterCriticalSection(&journal->lock);
+    while (!journal->io_error && journal->committed_seq < seq) {
+        SleepConditionVariableCS(&journal->committed, &journal->lock, INFINITE);
+    }
+    result = journal->committed_seq >= seq ? 0 : -1;
+    LeaveCriticalSection(&journal->lock);
+    return result;
+}
+
+/// @brief Снятие сообщения из неподтверждённых с записью о причине ('D' или 'X')
+static void resolve_pending(Journal *journal, unsigned long seq, char type) {
+    unsigned char record[SIMPLE_RECORD_SIZE];
+
+    if (!journal->flusher || seq == 0) return;
+
+    // Запись не ожидается: если она потеряется, сообщение будет отправлено повторно
+    EnterCriticalSection(&journal->lock);
+    int index = find_pending(journal, seq);
+    if (index >= 0) {
+        remove_pending(journal, index);
+        buffer_record(journal, record, encode_simple(record, type, seq));
+    }
+    LeaveCriticalSection(&journal->lock);
+}
+
+void journal_delivered(Journal *journal, unsigned long seq) {
+    resolve_pending(journal, seq, RECORD_DELIVERED);
+}
+
+void journal_abandoned(Journal *journal, unsigned long seq) {
+    resolve_pending(journal, seq, RECORD_ABANDONED);
+}
+
+int journal_pending(Journal *journal, JournalEntry *entries, int max) {
+    int count;
+
+    if (!journal->flusher) return 0;
+
+    EnterCriticalSection(&journal->lock);
+    count = journal->pending_count < max ? journal->pending_count : max;
+    memcpy(entries, journal->pending, (size_t)count * sizeof(JournalEntry));
+    LeaveCriticalSection(&journal->lock);
+    return count;
+}
+
+void journal_close(Journal *journal) {
+    if (!journal->flusher) return;
+
+    EnterCriticalSection(&journal->lock);
+    journal->stop = 1;
+    WakeConditionVariable(&journal->has_work);
+    LeaveCriticalSection(&journal->lock);
+
+    WaitForSingleObject(journal->flusher, INFINITE);
+    CloseHandle(journal->flusher);
+    journal->flusher = NULL;
+    _close(journal->fd);
+    journal->fd = -1;
+    DeleteCriticalSection(&journal->lock);
+}
@@ -0,0 +1,92 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <windows.h>
+#include "../config.h"
+
+#define JOURNAL_MESSAGE_SIZE 20 // Размер текста сообщения (как у PendingMessage)
+
+/// Уровни надёжности журнала
+typedef enum {
+    JOURNAL_DURABILITY_NONE,    // Журнал не ведётся
+    JOURNAL_DURABILITY_OS,      // Запись в ОС без сброса на диск (переживает падение процесса, но не ОС)
+    JOURNAL_DURABILITY_GROUP,   // Групповой сброс: один _commit на окно JOURNAL_BATCH_WINDOW_MS
+    JOURNAL_DURABILITY_SYNC     // Сброс сразу после каждой записи, без окна накопления
+} JournalDurability;
+
+/// @brief Неподтверждённое сообщение
+typedef struct {
+    unsigned long seq;                      // Номер записи журнала
+    int dest_address;                       // Кому отправляем
+    char message[JOURNAL_MESSAGE_SIZE];     // Текст сообщения
+} JournalEntry;
+
+/// @brief Журнал исходящей очереди
+/// Журнал ведётся в двух сегментах <prefix>.0 и <prefix>.1. Заполненный сегмент не растёт дальше:
+/// неподтверждённые сообщения переписываются снимком в начало второго сегмента, и сегменты меняются ролями.
+typedef struct {
+    JournalDurability durability;               // Уровень надёжности
+    char path[2][64];                           // Пути к сегментам
+    int fd;                                     // Дескриптор активного сегмента
+    int segment;                                // Номер активного сегмента (0 или 1)
+    unsigned long generation;                   // Поколение активного сегмента
+    long segment_bytes;                         // Объём данных в активном сегменте
+    char buffer[2][JOURNAL_BUFFER_SIZE];        // Буферы пачек: один заполняется, второй пишется на диск
+    int fill;                                   // Номер заполняемого буфера
+    size_t fill_len;                            // Объём данных в заполняемом буфере
+    unsigned long next_seq;                     // Следующий номер записи
+    unsigned long appended_seq;                 // Последний номер, попавший в буфер
+    unsigned long committed_seq;                // Последний номер, записанный с заданной надёжностью
+    JournalEntry pending[JOURNAL_MAX_PENDING];  // Неподтверждённые сообщения по возрастанию номера
+    int pending_count;                          // Количество неподтверждённых сообщений
+    int io_error;                               // Признак ошибки записи
+    int stop;                                   // Признак остановки потока сброса
+    CRITICAL_SECTION lock;                      // Блокировка состояния журнала
+    CONDITION_VARIABLE has_work;                // Сигнал потоку сброса о новых записях
+    CONDITION_VARIABLE committed;               // Сигнал ожидающим о завершении сброса
+    HANDLE flusher;                             // Поток группового сброса
+    int stack_used;                             // Наибольшая глубина стека потока сброса (профиль DACAP_EMBEDDED)
+} Journal;
+
+/// @brief Функция открытия журнала и восстановления неподтверждённых сообщений
+/// @param journal      - объект журнала
+/// @param prefix       - префикс путей к сегментам
+/// @param durability   - уровень надёжности
+/// @return             - количество восстановленных сообщений, -1 при ошибке
+int journal_open(Journal *journal, const char *prefix, JournalDurability durability);
+
+/// @brief Функция добавления сообщения в журнал (без ожидания записи на диск)
+/// @param journal      - объект журнала
+/// @param dest_address - адресат
+/// @param message      - текст сообщения
+/// @return             - номер записи, 0 если сообщение не попало в журнал
+unsigned long journal_append(Journal *journal, int dest_address, const char *message);
+
+/// @brief Функция ожидания записи сообщения с заданной надёжностью
+/// @param journal  - объект журнала
+/// @param seq      - номер записи
+/// @return         - 0 при успехе, -1 при ошибке записи
+int journal_wait(Journal *journal, unsigned long seq);
+
+/// @brief Функция отметки сообщения как доставленного
+/// @param journal  - объект журнала
+/// @param seq      - номер записи
+void journal_delivered(Journal *journal, unsigned long seq);
+
+/// @brief Функция снятия сообщения с отправки (попытки исчерпаны, при перезапуске не досылается)
+/// @param journal  - объект журнала
+/// @param seq      - номер записи
+void journal_abandoned(Journal *journal, unsigned long seq);
+
+/// @brief Функция получения неподтверждённых сообщений
+/// @param journal  - объект журнала
+/// @param entries  - массив для сообщений
+/// @param max      - размер массива
+/// @return         - количество скопированных сообщений
+int journal_pending(Journal *journal, JournalEntry *entries, int max);
+
+/// @brief Функция закрытия журнала с дописыванием накопленных записей
+/// @param journal  - объект журнала
+void journal_close(Journal *journal);
+
+#endif
@@ -3,6 +3,90 @@
 #include <time.h>
 #include <windows.h>
 #include "logger.h"
+#include "../embedded.h"
+
+/// @brief Название типа сообщения для статистического лога
+static const char *type_name(int type) {
+    return type == 0 ? "RTS" : type == 1 ? "CTS" : type == 2 ? "INFO" : "DELIVERED";
+}
+
+#ifdef DACAP_EMBEDDED
+
+/// @brief Запись строки в кольцевой буфер; при переполнении затираются самые старые строки
+static void ring_write(Logger *logger, const char *line, size_t length) {
+    EnterCriticalSection(&logger->lock);
+    for (size_t i = 0; i < length; i++) {
+        logger->ring[logger->head++] = line[i];
+        if (logger->head == sizeof(logger->ring)) {
+            logger->head = 0;
+            logger->wrapped = 1;
+        }
+    }
+    LeaveCriticalSection(&logger->lock);
+}
+
+void init_logger(Logger *logger, const char *ip) {
+    strncpy(logger->ip, ip, sizeof(logger->ip) - 1);
+    logger->ip[sizeof(logger->ip) - 1] = '\0';
+    logger->head = 0;
+    logger->wrapped = 0;
+    InitializeCriticalSection(&logger->lock);
+}
+
+void log_details(Logger *logger, const char *message) {
+    char line[LOG_LINE_SIZE];
+    SYSTEMTIME st;
+    GetSystemTime(&st);
+    int length = snprintf(line, sizeof(line), "[%04d-%02d-%02d %02d:%02d:%02d.%03d] %s\n",
+                          st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds, message);
+    if (length < 0) return;
+    if (length >= (int)sizeof(line)) {
+        // Длинная строка обрезается, перевод строки сохраняется
+        length = sizeof(line) - 1;
+        line[length - 1] = '\n';
+    }
+    ring_write(logger, line, (size_t)length);
+}
+
+void log_stats(Logger *logger, int type, int size, int src, int dest, int success) {
+    char line[LOG_LINE_SIZE];
+    SYSTEMTIME st;
+    GetSystemTime(&st);
+    int length = snprintf(line, sizeof(line), "%04d-%02d-%02d %02d:%02d:%02d.%03d,%s,%d,%d,%d,%d\n",
+                          st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds,
+                          type_name(type), size, src, dest, success);
+    if (length > 0 && length < (int)sizeof(line)) {
+        ring_write(logger, line, (size_t)length);
+    }
+}
+
+void log_dump(Logger *logger, FILE *out) {
+    EnterCriticalSection(&logger->lock);
+    if (logger->wrapped) {
+        // Первая строка после точки записи могла быть затёрта частично - она пропускается
+        const char *start = memchr(logger->ring + logger->head, '\n', sizeof(logger->ring) - logger->head);
+        if (start) {
+            start++;
+            fwrite(start, 1, (size_t)(logger->ring + sizeof(logger->ring) - start), out);
+            fwrite(logger->ring, 1, logger->head, out);
+        } else {
+            const char *first = memchr(logger->ring, '\n', logger->head);
+            if (first) {
+                first++;
+                fwrite(first, 1, (size_t)(logger->ring + logger->head - first), out);
+            }
+        }
+    } else {
+        fwrite(logger->ring, 1, logger->head, out);
+    }
+    LeaveCriticalSection(&logger->lock);
+}
+
+void close_logger(Logger *logger) {
+    DeleteCriticalSection(&logger->lock);
+}
+
+#else
 
 void init_logger(Logger *logger, const char *ip) {
     char details_filename[32], stats_filename[32];
@@ -43,8 +127,7 @@ void log_stats(Logger *logger, int type, int size, int src, int dest, int succes
     GetSystemTime(&st);
     fprintf(logger->stats_file, "%04d-%02d-%02d %02d:%02d:%02d.%03d,%s,%d,%d,%d,%d\n",
             st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds,
-            type == 0 ? "RTS" : type == 1 ? "CTS" : type == 2 ? "INFO" : "DELIVERED",
-            size, src, dest, success);
+            type_name(type), size, src, dest, success);
     fflush(logger->stats_file);
 }
 
@@ -57,4 +140,6 @@ void close_logger(Logger *logger) {
         fclose(logger->stats_file);
         logger->stats_file = NULL;
     }
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
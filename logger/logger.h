@@ -2,12 +2,26 @@
 #define LOGGER_H
 
 #include <stdio.h>
+#include "../config.h"
 
+#ifdef DACAP_EMBEDDED
+#include <windows.h>
+
+/// Во встраиваемом профиле журнал ведётся в кольцевом буфере в памяти вместо файлов
+typedef struct {
+    char ring[LOG_RING_SIZE];   // Кольцевой буфер строк журнала
+    size_t head;                // Позиция следующей записи
+    int wrapped;                // Признак того, что буфер был заполнен целиком
+    CRITICAL_SECTION lock;      // Запись идёт из нескольких потоков
+    char ip[16];                // IP клиента
+} Logger;
+#else
 typedef struct {
     FILE *details_file; // Текстовый лог
     FILE *stats_file;  // Статистический лог
     char ip[16];       // IP клиента
 } Logger;
+#endif
 
 /// @brief Функция инициализации объекта логера
 /// @param logger   - структура логгера
@@ -28,6 +42,13 @@ void log_details(Logger *logger, const char *message);
 /// @param success  - результат
 void log_stats(Logger *logger, int type, int size, int src, int dest, int success);
 
+#ifdef DACAP_EMBEDDED
+/// @brief Функция выгрузки кольцевого журнала (от старых строк к новым)
+/// @param logger   - структура логгера
+/// @param out      - поток вывода
+void log_dump(Logger *logger, FILE *out);
+#endif
+
 /// @brief Функция для закрытия логера
 /// @param logger - структура логгера
 void close_logger(Logger *logger);
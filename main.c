@@ -1,17 +1,23 @@
 #include <stdio.h>
+#include <stdarg.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
 #include "dacap.h"
+#include "trace/trace.h"
+#include "journal/journal.h"
+#include "embedded.h"
 
-// Настройка клиента
-#define BUFFER_SIZE 1024    // Размер принимаемого пакета
+// Настройка клиента (размеры буферов и таймауты - в config.h)
 #define PORT 9200           // порт подключения к серверу по умолчанию
-#define TIMEOUT_MS 2000     // Время ожидания между передачами 
+#define MODEM_BATCH_FRAMES 4 // Количество ответных кадров, отправляемых одним send
 
 static Logger logger;       // Структура логера
+static DacapEncoder tx_encoder; // Кодировщик пакетов потока записи
+static DacapEncoder rx_encoder; // Кодировщик пакетов потока чтения
 int success_count = 0;      // Счётчик успешных передач
 int failure_count = 0;      // Счётчик провальных передач
 
@@ -28,30 +34,135 @@ typedef struct {
     char message[20];   // Текст сообщения
     int dest_address;   // Кому отправляем
     DWORD start_time;   // Временная метка о начале отправки 
+    unsigned long long rts_us; // Время отправки RTS по монотонному счётчику, мкс (для замера задержки)
+    unsigned long seq;  // Номер записи в журнале (0 - сообщение не журналируется)
+    int attempt;        // Номер попытки отправки
 } PendingMessage;
 
-static ClientState client_state = IDLE;         // Исходное состояние клиента
-static PendingMessage pending = {{0}, 0, 0};    // Текущее сообщение по умолчанию
+static ClientState client_state = IDLE;                 // Исходное состояние клиента
+static PendingMessage pending = {{0}, 0, 0, 0, 0, 0};   // Текущее сообщение по умолчанию
+static volatile int connection_lost = 0;                // Признак потери связи с сервером
+
+// Журнал исходящей очереди
+static Journal journal;                                                 // Журнал неподтверждённых сообщений
+static JournalDurability journal_durability = JOURNAL_DURABILITY_GROUP; // Уровень надёжности журнала
+static int journal_enabled = 0;                                         // Признак ведения журнала
+static int journal_dropped = 0;                                         // Сообщения, не попавшие в журнал
+
+// Запись и воспроизведение трассы
+static int capture_enabled = 0;     // Признак записи трассы
+static TraceWriter trace_writer;    // Трасса для записи
+static TraceReader trace_reader;    // Трасса для воспроизведения
+static TraceRecord replay_record;   // Буфер записи воспроизводимой трассы
+static double replay_speed = 1.0;   // Коэффициент ускорения воспроизведения (0 - максимальная скорость)
+static TraceStats run_stats;        // Статистика текущего прогона
+static int offline_mode = 0;        // Воспроизведение без сервера: строки модема берутся из трассы
+static TraceReader modem_reader;    // Трасса для подачи строк модема в режиме без сервера
+static TraceRecord modem_record;    // Буфер строки модема из трассы
+static unsigned long long replay_start_us; // Начало воспроизведения по монотонному счётчику, мкс
+static volatile int replay_commands_started = 0; // Количество команд, воспроизведение которых начато
+
+// Разбор потока строк модема (одно соединение на клиента)
+static char modem_carry[BUFFER_SIZE];   // Начало строки, не завершённой в предыдущем recv
+static int modem_carry_len = 0;         // Длина начала строки
+static int modem_carry_overflow = 0;    // Признак строки длиннее буфера: отбрасывается до '\n'
+
+/// @brief Вывод на консоль с ограничением длины строки CONSOLE_LINE_SIZE
+/// Весь вывод клиента после инициализации идёт через эту функцию или console_echo.
+/// Во встраиваемом профиле вывод направляется в кольцевой журнал.
+/// @param format - строка формата printf
+static void console_printf(const char *format, ...) {
+    char line[CONSOLE_LINE_SIZE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (length < 0) return;
+#ifdef DACAP_EMBEDDED
+    if (length >= (int)sizeof(line)) length = sizeof(line) - 1;
+    while (length > 0 && line[length - 1] == '\n') {
+        line[--length] = '\0';
+    }
+    log_details(&logger, line);
+#else
+    fputs(line, stdout);
+    fflush(stdout);
+#endif
+}
+
+/// @brief Запись строки в журнал событий с выводом на консоль
+/// Во встраиваемом профиле консоль сама пишется в кольцевой журнал, поэтому строка попадает туда один раз.
+/// @param line - строка без перевода строки
+static void log_and_print(const char *line) {
+    log_details(&logger, line);
+#ifndef DACAP_EMBEDDED
+    console_printf("%s\n", line);
+#endif
+}
+
+/// @brief Эхо вводимых в консоль символов
+/// Во встраиваемом профиле эхо не выводится: введённая команда попадает в кольцевой журнал целиком.
+/// @param text - выводимые символы
+static void console_echo(const char *text) {
+#ifdef DACAP_EMBEDDED
+    (void)text;
+#else
+    fputs(text, stdout);
+    fflush(stdout);
+#endif
+}
+
+/// @brief Запись наибольшей глубины стека потока в журнал событий (профиль DACAP_EMBEDDED)
+/// @param thread   - название потока
+/// @param used     - затёртый объём стека, STACK_HIGH_WATER()
+static void log_stack_usage(const char *thread, int used) {
+#if defined(DACAP_EMBEDDED) && STACK_PAINT_SIZE > 0
+    char log[80];
+    snprintf(log, sizeof(log), "Stack high-water %s: %d of %d bytes", thread, used, STACK_PAINT_SIZE);
+    log_details(&logger, log);
+#else
+    (void)thread;
+    (void)used;
+#endif
+}
+
+/// @brief Отправка данных модему
+/// В режиме без сервера данные никуда не уходят: ответы модема подаются из трассы.
+/// @param socket_fd    - идентификатор сокета
+/// @param data         - данные
+/// @param length       - длина данных
+/// @return             - результат send
+static int modem_send(int socket_fd, const char *data, int length) {
+    if (offline_mode) {
+        return length;
+    }
+    int result = send(socket_fd, data, length, 0);
+    if (result < 0) {
+        connection_lost = 1;    // Ошибка отправки в TCP-сокет означает разрыв соединения
+    }
+    return result;
+}
 
 /// @brief Функция дробления строк по разделителю (запятой)
 /// @param sendline - пришедшая строка
-/// @param chunks   - буффер для хранения подстрок
+/// @param chunks   - буффер для хранения подстрок (по 20 символов на подстроку)
 /// @return         - количество подстрок
 int comma_parser(char* sendline, char* chunks) {
-    char *dup = strdup(sendline);   // Дубликат прищедшей строки без изменения исходной
-    char *chunk = strtok(dup, ","); // Первичный разбор строки по первой запятой
     int i = 0;
-    // Обработка остальных подстрок по остальным запятым в строке
-    while (chunk != NULL) {
-        if (strcmp(chunk, "") == 0) {
-            chunk = strtok(NULL, ",");
-            continue;
+    const char *p = sendline;
+    // Разбор на месте без копии строки; пустые подстроки пропускаются
+    while (*p) {
+        const char *start = p;
+        while (*p && *p != ',') p++;
+        if (p > start) {
+            size_t length = (size_t)(p - start);
+            if (length > 19) length = 19;
+            memcpy(chunks + i * 20, start, length);
+            chunks[i * 20 + length] = '\0';
+            i++;
         }
-        strcpy((char *)(chunks + i * 20), chunk);
-        i++;
-        chunk = strtok(NULL, ",");
+        if (*p == ',') p++;
     }
-    free(dup); // освобождение ресурсов
     return i;
 }
 
@@ -60,7 +171,10 @@ int comma_parser(char* sendline, char* chunks) {
 /// @param my_address   - гидроакустический адрес текущего клиента
 /// @param dest_address - гидроакустический адрес узла, которому отправляем
 /// @param message      - сообщение на отправку
-void send_message(int socket_fd, int my_address, int dest_address, const char *message) {
+/// @param seq          - номер записи сообщения в журнале (0 - без журнала)
+/// @param attempt      - номер попытки отправки
+/// @return             - 0, если RTS отправлен, иначе -1
+int send_message(int socket_fd, int my_address, int dest_address, const char *message, unsigned long seq, int attempt) {
     char log[100];
     snprintf(log, sizeof(log), "DEBUG: send_message: my_address=%d, dest_address=%d, message=%s", my_address, dest_address, message);
     log_details(&logger, log);
@@ -69,26 +183,26 @@ void send_message(int socket_fd, int my_address, int dest_address, const char *m
     if (client_state != IDLE) {
         snprintf(log, sizeof(log), "Client busy, state=%d", client_state);
         log_details(&logger, log);
-        return;
+        return -1;
     }
 
     // Подготовка запроса на отправку
-    DacapResult result = dacap_send(my_address, dest_address, message, &logger);
+    DacapResult result = dacap_send(my_address, dest_address, message, &logger, &tx_encoder);
     if (result.status == -1) {
         snprintf(log, sizeof(log), "Failed to prepare RTS");
         log_details(&logger, log);
         log_stats(&logger, MSG_RTS, 3, my_address, dest_address, 0);
         failure_count++;
-        return;
+        return -1;
     }
 
     // Отправка RTS
-    if (send(socket_fd, result.sendline, strlen(result.sendline), 0) < 0) {
+    if (modem_send(socket_fd, result.sendline, result.length) < 0) {
         snprintf(log, sizeof(log), "Failed to send RTS: %d", WSAGetLastError());
         log_details(&logger, log);
         log_stats(&logger, MSG_RTS, 3, my_address, dest_address, 0);
         failure_count++;
-        return;
+        return -1;
     }
 
     // Логирование данных об отправке
@@ -100,6 +214,176 @@ void send_message(int socket_fd, int my_address, int dest_address, const char *m
     pending.message[sizeof(pending.message) - 1] = '\0';
     pending.dest_address = dest_address;
     pending.start_time = GetTickCount();
+    pending.rts_us = trace_clock_us();
+    pending.seq = seq;
+    pending.attempt = attempt;
+    return 0;
+}
+
+/// @brief Отправка ответных кадров, накопленных при разборе принятого блока, одним send
+/// @param socket_fd    - идентификатор сокета
+/// @param my_address   - гидроакустический адрес текущего клиента
+/// @param frames       - кадры (CTS и INFO)
+/// @param count        - количество кадров
+static void send_frames(int socket_fd, int my_address, const DacapFrame *frames, int count) {
+    char sendline[MODEM_BATCH_FRAMES * DACAP_SENDLINE_SIZE];
+    char log[100];
+    int length = dacap_encode_frames(&rx_encoder, sendline, sizeof(sendline), frames, count);
+    int sent = length >= 0 && modem_send(socket_fd, sendline, length) >= 0;
+
+    for (int i = 0; i < count; i++) {
+        const char *name = frames[i].type == MSG_CTS ? "CTS" : "INFO";
+        int size = frames[i].type == MSG_CTS ? 3 : (int)strlen(frames[i].data) + 5;
+        if (sent) {
+            snprintf(log, sizeof(log), "Sent %s to %d", name, frames[i].dest);
+        } else {
+            snprintf(log, sizeof(log), "Failed to send %s: %d", name, WSAGetLastError());
+        }
+        log_details(&logger, log);
+        log_stats(&logger, frames[i].type, size, my_address, frames[i].dest, sent);
+        if (frames[i].type == MSG_INFO && !sent) {
+            client_state = IDLE;
+            failure_count++;
+        }
+    }
+}
+
+/// @brief Обработка одной строки, принятой от модема
+/// Ответ (CTS на RTS или INFO на CTS) не отправляется сразу, а добавляется в frames.
+/// @param my_address   - гидроакустический адрес текущего клиента
+/// @param line         - строка без символа перевода строки
+/// @param frames       - накопленные ответные кадры
+/// @param count        - количество накопленных кадров
+/// @return             - новое количество кадров
+static int handle_modem_line(int my_address, char *line, DacapFrame *frames, int count) {
+    char log[100];
+    Packet packet; // Подготовка структуры для дальнейшего разбора пакета
+
+    // Разбор пришедшего пакета
+    if (dacap_parse_packet(line, &packet) != 0) {
+        return count;
+    }
+    DacapResult result = dacap_handle_packet(&packet, my_address, &logger, &rx_encoder);
+    if (result.status == -1) {
+        log_details(&logger, "Failed to handle packet");
+        return count;
+    }
+
+    // Автоматическая отправка CTS, если получен RTS
+    if (result.status == 0 && result.sendline[0] != '\0') {
+        frames[count].dest = packet.src;
+        frames[count].type = result.type;
+        frames[count].data = NULL;
+        count++;
+    }
+
+    // Автоматическая отправка INFO, если получен CTS
+    if (result.type == MSG_CTS && packet.type == MSG_CTS && client_state == SENDING_RTS && packet.src == pending.dest_address) {
+        frames[count].dest = pending.dest_address;
+        frames[count].type = MSG_INFO;
+        frames[count].data = pending.message;
+        count++;
+        client_state = SENDING_INFO;
+        pending.start_time = GetTickCount();
+    } else if (result.type == MSG_DELIVERED && client_state == SENDING_INFO && packet.dest == pending.dest_address) {
+        snprintf(log, sizeof(log), "DEBUG: DELIVERED dest=%d, pending_dest=%d", packet.dest, pending.dest_address);
+        log_details(&logger, log);
+        log_details(&logger, "Message sent successfully");
+        log_stats(&logger, MSG_DELIVERED, 0, my_address, packet.dest, 1);
+        trace_stats_add_latency(&run_stats, (unsigned long)((trace_clock_us() - pending.rts_us + 500) / 1000));
+        journal_delivered(&journal, pending.seq);
+        success_count++;
+        client_state = IDLE;
+        pending.message[0] = '\0';
+        pending.dest_address = 0;
+    } else if (result.type == MSG_INFO) {
+        console_printf("Message from %d: %s\n", packet.src, packet.payload);
+        client_state = IDLE;
+        log_stats(&logger, MSG_INFO, strlen(packet.payload), packet.src, my_address, 1);
+    }
+    return count;
+}
+
+/// @brief Добавление части строки к началу, оставшемуся от предыдущего recv
+/// Строка длиннее буфера отбрасывается целиком: разобрать её обрезанной нельзя.
+/// @param data     - часть строки
+/// @param length   - длина части
+static void carry_modem_data(const char *data, int length) {
+    if (modem_carry_overflow || modem_carry_len + length > (int)sizeof(modem_carry) - 1) {
+        if (!modem_carry_overflow) {
+            log_details(&logger, "Modem line too long, dropped");
+        }
+        modem_carry_overflow = 1;
+        modem_carry_len = 0;
+        return;
+    }
+    memcpy(modem_carry + modem_carry_len, data, (size_t)length);
+    modem_carry_len += length;
+    modem_carry[modem_carry_len] = '\0';
+}
+
+/// @brief Обработка блока данных, принятого от модема
+/// Один recv может вернуть несколько строк или только часть строки. Разбираются лишь строки,
+/// завершённые '\n'; незавершённый хвост блока сохраняется и дополняется следующим recv.
+/// Ответы на весь блок уходят одним send.
+/// @param socket_fd    - идентификатор сокета
+/// @param my_address   - гидроакустический адрес текущего клиента
+/// @param buffer       - принятые данные с завершающим нулём (изменяются при разборе)
+/// @param length       - длина данных
+static void handle_modem_data(int socket_fd, int my_address, char *buffer, int length) {
+    DacapFrame frames[MODEM_BATCH_FRAMES];
+    int count = 0;
+    char *line = buffer;
+    char *end = buffer + length;
+    char *next;
+
+    while ((next = memchr(line, '\n', (size_t)(end - line))) != NULL) {
+        *next = '\0';
+        if (modem_carry_len > 0 || modem_carry_overflow) {
+            // Конец строки, начатой в предыдущем recv
+            carry_modem_data(line, (int)(next - line));
+            line = modem_carry_overflow ? NULL : modem_carry;
+            modem_carry_len = 0;
+            modem_carry_overflow = 0;
+        }
+        if (line) {
+            // Строка даёт не больше одного ответа, поэтому место проверяется заранее
+            if (count == MODEM_BATCH_FRAMES) {
+                send_frames(socket_fd, my_address, frames, count);
+                count = 0;
+            }
+            count = handle_modem_line(my_address, line, frames, count);
+        }
+        line = next + 1;
+    }
+    if (line < end) {
+        carry_modem_data(line, (int)(end - line));
+    }
+    if (count > 0) {
+        send_frames(socket_fd, my_address, frames, count);
+    }
+}
+
+/// @brief Приём блока данных от модема: запись в трассу, лог и обработка
+/// @param socket_fd    - идентификатор сокета
+/// @param my_address   - гидроакустический адрес текущего клиента
+/// @param buffer       - принятые данные с завершающим нулём (изменяются при разборе)
+/// @param length       - длина данных
+static void receive_modem_data(int socket_fd, int my_address, char *buffer, int length) {
+    if (capture_enabled) {
+        trace_record(&trace_writer, TRACE_MODEM_LINE, buffer, length);
+    }
+#ifdef DACAP_EMBEDDED
+    // Консоль пишется в кольцевой журнал: отдельная запись в журнал событий удвоила бы блок
+    console_printf("Received: %s\n", buffer);
+#else
+    char log[150];
+    snprintf(log, sizeof(log), "Received: %s", buffer);
+    log_details(&logger, log);
+    console_printf("Received: %s\n", buffer);
+#endif
+
+    handle_modem_data(socket_fd, my_address, buffer, length);
 }
 
 /// @brief Функция чтения данных из сокета
@@ -110,9 +394,10 @@ DWORD WINAPI read_from_socket(LPVOID params) {
     int *args = (int *)params;
     int client_socket = args[0];
     int my_address = args[1];
-    char buffer[1024];
+    char buffer[BUFFER_SIZE];
     int bytes_received;
 
+    STACK_PAINT();
     log_details(&logger, "read_from_socket started");
 
     // Суперцикл для чтения данных из сокета
@@ -120,73 +405,11 @@ DWORD WINAPI read_from_socket(LPVOID params) {
         bytes_received = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
         if (bytes_received > 0) {
             buffer[bytes_received] = '\0'; // Добавление символа конца строки для каждого нового принятого пакета
-            
-            char log[150];
-            snprintf(log, sizeof(log), "Received: %s", buffer);
-            log_details(&logger, log);
-
-            printf("Received: %s\n", buffer);
-            
-            Packet packet; // Подготовка структуры для дальнейшего разбора пакета
-            
-            // Разбор пришедшего пакета
-            if (dacap_parse_packet(buffer, &packet) == 0) {
-                DacapResult result = dacap_handle_packet(&packet, my_address, &logger);
-                if (result.status == -1) {
-                    log_details(&logger, "Failed to handle packet");
-                    continue;
-                }
-                
-                // Автоматическая отправка CTS, если получен RTS
-                if (result.status == 0 && result.sendline[0] != '\0') {
-                    if (send(client_socket, result.sendline, strlen(result.sendline), 0) < 0) {
-                        char log[100];
-                        snprintf(log, sizeof(log), "Failed to send %s: %d", 
-                                 result.type == MSG_CTS ? "CTS" : "INFO", WSAGetLastError());
-                        log_details(&logger, log);
-                        log_stats(&logger, result.type, result.type == MSG_CTS ? 3 : strlen(pending.message) + 5, my_address, packet.src, 0);
-                    } else {
-                        char log[100];
-                        snprintf(log, sizeof(log), "Sent %s to %d", 
-                                 result.type == MSG_CTS ? "CTS" : "INFO", packet.src);
-                        log_details(&logger, log);
-                        log_stats(&logger, result.type, result.type == MSG_CTS ? 3 : strlen(pending.message) + 5, my_address, packet.src, 1);
-                    }
-                }
-
-                // Автоматическая отправка INFO, если получен CTS
-                if (result.type == MSG_CTS && client_state == SENDING_RTS && packet.src == pending.dest_address) {
-                    char sendline[100];
-                    dacap_generate_packet(sendline, pending.dest_address, MSG_INFO, pending.message);
-                    if (send(client_socket, sendline, strlen(sendline), 0) < 0) {
-                        log_details(&logger, log);
-                        log_stats(&logger, MSG_INFO, strlen(pending.message) + 5, my_address, pending.dest_address, 0);
-                        client_state = IDLE;
-                        failure_count++;
-                    } else {
-                        log_details(&logger, log);
-                        log_stats(&logger, MSG_INFO, strlen(pending.message) + 5, my_address, pending.dest_address, 0);
-                        client_state = SENDING_INFO;
-                        pending.start_time = GetTickCount();
-                    }
-                } else if (result.type == MSG_DELIVERED && client_state == SENDING_INFO && packet.dest == pending.dest_address) {
-                    snprintf(log, sizeof(log), "DEBUG: DELIVERED dest=%d, pending_dest=%d", packet.dest, pending.dest_address);
-                    log_details(&logger, log);
-                    log_details(&logger, "Message sent successfully");
-                    log_stats(&logger, MSG_DELIVERED, 0, my_address, packet.dest, 1);
-                    success_count++;
-                    client_state = IDLE;
-                    pending.message[0] = '\0';
-                    pending.dest_address = 0;
-                } else if (result.type == MSG_INFO) {
-                    client_state = IDLE;
-                    log_stats(&logger, MSG_INFO, strlen(packet.payload), packet.src, my_address, 1);
-                }
-            }
+            receive_modem_data(client_socket, my_address, buffer, bytes_received);
             memset(buffer, 0, sizeof(buffer));
         } else if (bytes_received == 0) {
             // Сервер закрыл соединение
-            printf("Server closed the connection.\n");
+            console_printf("Server closed the connection.\n");
             log_details(&logger, "Server closed the connection");
             break;
         } else {
@@ -197,16 +420,233 @@ DWORD WINAPI read_from_socket(LPVOID params) {
                 Sleep(100);
                 continue;
             }
-            printf("Receive error: %d\n", error);
+            console_printf("Receive error: %d\n", error);
             log_details(&logger, "Receive error");
             break;
         }
     }
+    connection_lost = 1;
     log_details(&logger, "Receive error");
+    log_stack_usage("read_from_socket", STACK_HIGH_WATER());
     return 0;
 }
 
 
+/// @brief Запись сообщения в журнал перед отправкой
+/// @param dest_address - адресат
+/// @param message      - текст сообщения
+/// @return             - номер записи, 0 если сообщение не журналируется
+static unsigned long journal_message(int dest_address, const char *message) {
+    char log[100];
+    unsigned long seq;
+
+    if (!journal_enabled) return 0;
+    seq = journal_append(&journal, dest_address, message);
+    if (seq == 0) {
+        // Журнал переполнен или не пишется на диск: сообщение уходит без гарантии доставки
+        journal_dropped++;
+        snprintf(log, sizeof(log), "Journal full or failed, message to %d is not durable (%d so far)", dest_address, journal_dropped);
+        log_and_print(log);
+    }
+    return seq;
+}
+
+/// @brief Завершение попыток отправки журналируемого сообщения в текущем сеансе
+/// Сообщение остаётся в журнале и досылается при следующем запуске. С отправки навсегда
+/// оно снимается, только если задан SEND_ABANDON_ATTEMPTS и связь с сервером не потеряна.
+/// @param seq          - номер записи в журнале (0 - сообщение не журналируется)
+/// @param dest_address - адресат
+/// @param attempts     - количество сделанных попыток
+static void give_up_message(unsigned long seq, int dest_address, int attempts) {
+    char log[100];
+
+    if (seq == 0) return;
+    if (SEND_ABANDON_ATTEMPTS > 0 && attempts >= SEND_ABANDON_ATTEMPTS && !connection_lost) {
+        journal_abandoned(&journal, seq);
+        snprintf(log, sizeof(log), "Message %lu to %d abandoned after %d attempts", seq, dest_address, attempts);
+    } else {
+        snprintf(log, sizeof(log), "Message %lu to %d not delivered, kept in journal for next start", seq, dest_address);
+    }
+    log_and_print(log);
+}
+
+/// @brief Проверка истечения таймера ожидания CTS или DELIVERED
+/// Журналируемое сообщение отправляется повторно, пока не исчерпаны SEND_MAX_ATTEMPTS попыток.
+/// @param socket_fd  - идентификатор сокета
+/// @param my_address - гидроакустический адрес текущего клиента
+static void check_timeout(int socket_fd, int my_address) {
+    if ((client_state == SENDING_RTS || client_state == SENDING_INFO) && (GetTickCount() - pending.start_time) > TIMEOUT_MS) {
+        char log[100];
+        PendingMessage failed = pending;
+        snprintf(log, sizeof(log), "Timeout waiting for %s from %d", 
+                 client_state == SENDING_RTS ? "CTS" : "DELIVERED", pending.dest_address);
+        log_details(&logger, log);
+        log_stats(&logger, client_state == SENDING_RTS ? MSG_CTS : MSG_DELIVERED, 0, my_address, pending.dest_address, 0);
+        failure_count++;
+        client_state = IDLE;
+        pending.message[0] = '\0';
+        pending.dest_address = 0;
+
+        if (failed.seq == 0) return;
+        if (!connection_lost && failed.attempt < SEND_MAX_ATTEMPTS) {
+            snprintf(log, sizeof(log), "Retrying message %lu to %d, attempt %d", failed.seq, failed.dest_address, failed.attempt + 1);
+            log_details(&logger, log);
+            if (send_message(socket_fd, my_address, failed.dest_address, failed.message, failed.seq, failed.attempt + 1) == 0) {
+                return;
+            }
+        }
+        give_up_message(failed.seq, failed.dest_address, failed.attempt);
+    }
+}
+
+/// @brief Отправка сообщения с ожиданием завершения передачи (цикл от IDLE, RTS/CTS/INFO до обратно IDLE)
+/// Журналируемое сообщение отправляется повторно, пока не исчерпаны SEND_MAX_ATTEMPTS попыток.
+/// @param socket_fd    - идентификатор сокета
+/// @param my_address   - гидроакустический адрес текущего клиента
+/// @param dest_address - гидроакустический адрес узла, которому отправляем
+/// @param message      - сообщение на отправку
+/// @param seq          - номер записи сообщения в журнале (0 - без журнала)
+/// @param index        - порядковый номер сообщения в серии
+static void send_and_wait(int socket_fd, int my_address, int dest_address, const char *message, unsigned long seq, int index) {
+    int attempt = 0;
+    int delivered = 0;
+
+    // Ожидание завершения предыдущей передачи, иначе сообщение было бы отброшено как "Client busy"
+    while (client_state != IDLE) {
+        check_timeout(socket_fd, my_address);
+        Sleep(10);
+    }
+    while (!delivered && attempt < (seq ? SEND_MAX_ATTEMPTS : 1) && !connection_lost) {
+        int successes = success_count;
+        attempt++;
+        if (attempt > 1) {
+            Sleep(100); // Пауза перед повторной попыткой
+        }
+        console_printf("Sending message %d: %s\n", index, message);
+        if (send_message(socket_fd, my_address, dest_address, message, seq, attempt) != 0) {
+            continue;
+        }
+        while (client_state != IDLE && (GetTickCount() - pending.start_time) < TIMEOUT_MS) {
+            Sleep(10);
+        }
+        if (client_state != IDLE) {
+            char log[100];
+            snprintf(log, sizeof(log), "Message %d timed out", index);
+            log_details(&logger, log);
+            log_stats(&logger, MSG_DELIVERED, 0, my_address, dest_address, 0);
+            failure_count++;
+            client_state = IDLE;
+            pending.message[0] = '\0';
+            pending.dest_address = 0;
+            console_printf("Message %d timed out\n", index);
+        }
+        delivered = success_count > successes;
+    }
+    if (!delivered) {
+        give_up_message(seq, dest_address, attempt);
+    }
+    Sleep(100); // Пауза между сообщениями
+}
+
+/// @brief Повторная отправка сообщений, не подтверждённых до перезапуска клиента
+/// @param socket_fd    - идентификатор сокета
+/// @param my_address   - гидроакустический адрес текущего клиента
+static void resend_journal(int socket_fd, int my_address) {
+    static JournalEntry entries[JOURNAL_MAX_PENDING];   // Слишком велик для стека потока
+    char log[100];
+    int count = journal_pending(&journal, entries, JOURNAL_MAX_PENDING);
+
+    if (count == 0) return;
+    snprintf(log, sizeof(log), "Resending %d unacknowledged messages from journal", count);
+    log_and_print(log);
+    for (int i = 0; i < count; i++) {
+        send_and_wait(socket_fd, my_address, entries[i].dest_address, entries[i].message, entries[i].seq, i);
+    }
+}
+
+/// @brief Обработка одной пользовательской команды
+/// @param socket_fd    - идентификатор сокета
+/// @param my_address   - гидроакустический адрес текущего клиента
+/// @param command      - строка команды (изменяется при разборе)
+/// @return             - 1, если введена команда выхода, иначе 0
+static int process_command(int socket_fd, int my_address, char *command) {
+    char stats[100];
+    char log[150];
+    int num_dest;
+
+    // Буффер сообщений для множественной отправки
+    static const char *messages[10] = {
+        "Message 0", "Message 1", "Message 2", "Message 3", "Message 4",
+        "Message 5", "Message 6", "Message 7", "Message 8", "Message 9"
+    };
+
+    // Запись команды в трассу до её разбора
+    if (capture_enabled) {
+        trace_record(&trace_writer, TRACE_USER_COMMAND, command, (int)strlen(command));
+    }
+    snprintf(log, sizeof(log), "Command: %s", command);
+    log_details(&logger, log);
+
+    // Выход из приложения, если введён "exit"
+    if (strcmpi(command, "exit") == 0) {
+        log_details(&logger, "Received exit command");
+        return 1;
+    }
+
+    // Парсинг пользовательской команды
+    char *chunk = strtok(command, ",");
+    char *destination = strtok(NULL, ",");
+    if (!destination || !chunk) {
+        console_printf("Invalid command format. Use: message,<address> or msi,<address>\n");
+        log_details(&logger, "Invalid command format");
+        return 0;
+    }
+    num_dest = atoi(destination);
+    if (num_dest <= 0) {
+        log_and_print("Invalid destination address");
+        return 0;
+    }
+
+    // Множественная отправка при вводе команды "msi"
+    if (strcmpi(chunk, "msi") == 0) {
+        // Вся серия записывается в журнал одной пачкой с одним сбросом на диск.
+        // Каждое сообщение серии отправляется (send_and_wait ждёт освобождения клиента),
+        // а затем либо доставляется, либо снимается с отправки, поэтому в журнале не залёживается.
+        unsigned long seqs[10];
+        unsigned long last_seq = 0;
+        for (int i = 0; i < 10; i++) {
+            seqs[i] = journal_message(num_dest, messages[i]);
+            if (seqs[i]) last_seq = seqs[i];
+        }
+        if (journal_wait(&journal, last_seq) != 0) {
+            log_details(&logger, "Journal write failed");
+        }
+        for (int i = 0; i < 10; i++) {
+            send_and_wait(socket_fd, my_address, num_dest, messages[i], seqs[i], i);
+        }
+        snprintf(stats, sizeof(stats), "Transmission completed: %d successes, %d failures", success_count, failure_count);
+        log_details(&logger, stats);
+    } else {
+        // Отправка одного пользовательского сообщения: в журнал попадает только сообщение,
+        // принятое к отправке, а не отброшенное из-за занятости клиента
+        if (client_state != IDLE) {
+            console_printf("Client busy, message to %d is not sent\n", num_dest);
+            log_details(&logger, "Client busy, message dropped");
+        } else {
+            unsigned long seq = journal_message(num_dest, chunk);
+            if (journal_wait(&journal, seq) != 0) {
+                log_details(&logger, "Journal write failed");
+            }
+            console_printf("Sending message: %s to %d\n", chunk, num_dest);
+            if (send_message(socket_fd, my_address, num_dest, chunk, seq, 1) != 0) {
+                give_up_message(seq, num_dest, 1);
+            }
+        }
+    }
+    console_printf("Enter command: ");
+    return 0;
+}
+
 /// @brief Функция записи данных в сокет
 /// @param params - структура параметров подключения
 /// @return 
@@ -216,39 +656,26 @@ DWORD WINAPI write_to_client(LPVOID params) {
     int socket_fd = args[0];
     int my_address = args[1];
     char sendline[100];
-    char stats[100];
-    int num_dest;
     char input_buffer[100] = {0};
     int input_pos = 0;
 
-    // Буффер сообщений для множественной отправки
-    const char *messages[10] = {
-        "Message 0", "Message 1", "Message 2", "Message 3", "Message 4",
-        "Message 5", "Message 6", "Message 7", "Message 8", "Message 9"
-    };
+    STACK_PAINT();
 
     // Логирование 
     log_details(&logger, "Starting write_to_thread");
-    printf("Input format: multiline string, or\nmsi,<address> or exit\n");
+    console_printf("Input format: multiline string, or\nmsi,<address> or exit\n");
     log_details(&logger, "Ready for input");
 
+    // Досылка сообщений, оставшихся в журнале с прошлого запуска
+    resend_journal(socket_fd, my_address);
+
     // Получение доступа к консоли
     HANDLE stdin_handle = GetStdHandle(STD_INPUT_HANDLE);
 
     // Супер цикл отправки сообщений в сокет
     while (1) {
         // Проверка на истечение таймера после отправки 
-        if (client_state == SENDING_INFO && (GetTickCount() - pending.start_time) > TIMEOUT_MS) {
-            char log[100];
-            snprintf(log, sizeof(log), "Timeout waiting for %s from %d", 
-                     client_state == SENDING_RTS ? "CTS" : "DELIVERED", pending.dest_address);
-            log_details(&logger, log);
-            log_stats(&logger, client_state == SENDING_RTS ? MSG_CTS : MSG_DELIVERED, 0, my_address, pending.dest_address, 0);
-            failure_count++;
-            client_state = IDLE;
-            pending.message[0] = '\0';
-            pending.dest_address = 0;
-        }
+        check_timeout(socket_fd, my_address);
 
         // Чтение пользовательского ввода из консоли
         INPUT_RECORD input_record;
@@ -266,68 +693,19 @@ DWORD WINAPI write_to_client(LPVOID params) {
                         input_buffer[0] = '\0';
                         input_pos = 0;
 
-                        // Выход из приложения, если введён "exit"
-                        if (strcmpi(sendline, "exit") == 0) {
-                            log_details(&logger, "Received exit command");
+                        if (process_command(socket_fd, my_address, sendline)) {
                             break;
                         }
-
-                        // Парсинг пользовательской команды
-                        char *chunk = strtok(sendline, ",");
-                        char *destination = strtok(NULL, ",");
-                        if (!destination || !chunk) {
-                            printf("Invalid command format. Use: message,<address> or msi,<address>\n");
-                            log_details(&logger, "Invalid command format");
-                            continue;
-                        }
-                        num_dest = atoi(destination);
-                        if (num_dest == 0) {
-                            fprintf(stderr, "Invalid destination address\n");
-                            continue;
-                        }
-
-                        // Множественная отправка при вводе команды "msi"
-                        if (strcmpi(chunk, "msi") == 0) {
-                            for (int i = 0; i < 10; i++) {
-                                printf("Sending message %d: %s\n", i, messages[i]);
-                                send_message(socket_fd, my_address, num_dest, messages[i]);
-                                // Ожидание отправки сообщений (цикл от IDLE, RTS/CTS/INFO до обратно IDLE)
-                                while (client_state != IDLE && (GetTickCount() - pending.start_time) < TIMEOUT_MS) {
-                                    Sleep(10);
-                                }
-                                if (client_state != IDLE) {
-                                    char log[100];
-                                    snprintf(log, sizeof(log), "Message %d timed out", i);
-                                    log_details(&logger, log);
-                                    log_stats(&logger, MSG_DELIVERED, 0, my_address, num_dest, 0);
-                                    failure_count++;
-                                    client_state = IDLE;
-                                    pending.message[0] = '\0';
-                                    pending.dest_address = 0;
-                                    printf("Message %d timed out\n", i);
-                                }
-                                Sleep(100); // Пауза между сообщениями
-                            }
-                            snprintf(stats, sizeof(stats), "Transmission completed: %d successes, %d failures", success_count, failure_count);
-                            log_details(&logger, stats);
-                        } else {
-                            // Отправка одного пользовательского сообщения
-                            printf("Sending message: %s to %d\n", chunk, num_dest);
-                            send_message(socket_fd, my_address, num_dest, chunk);
-                        }
-                        printf("Enter command: ");
-                        fflush(stdout);
                     }
                 } else if (c >= 32 && c <= 126 && input_pos < sizeof(input_buffer) - 1) {
                     // Обработка ввода отдельных символов
                     input_buffer[input_pos++] = c;
-                    putchar(c);
-                    fflush(stdout);
+                    input_buffer[input_pos] = '\0';
+                    console_echo(input_buffer + input_pos - 1);
                 } else if (c == 8 && input_pos > 0) {
                     // Нажатие Backspace
                     input_buffer[--input_pos] = '\0';
-                    printf("\b \b");
-                    fflush(stdout);
+                    console_echo("\b \b");
                 }
             } else {
                 ReadConsoleInput(stdin_handle, &input_record, 1, &events_read);
@@ -337,49 +715,149 @@ DWORD WINAPI write_to_client(LPVOID params) {
     }
 
     log_details(&logger, "Exiting write_to_thread");
+    log_stack_usage("write_to_client", STACK_HIGH_WATER());
     return 0;
 }
 
+/// @brief Функция воспроизведения пользовательских команд из трассы
+/// @param params - структура параметров подключения
+/// @return 
+DWORD WINAPI replay_commands(LPVOID params) {
+    // Выгрузка параметров подключения из структуры
+    int *args = (int *)params;
+    int socket_fd = args[0];
+    int my_address = args[1];
+    TraceRecord *record = &replay_record;
+    int result;
 
-int main(int argc, char *argv[]) {
-    // Проверка введённых параметров консоли согласно формату:
-    // ./client.exe 127.0.0.n 9200
-    if (argc != 3) {
-        printf("Usage: %s <IP Address> <Port>\n", argv[0]);
-        return 1;
+    STACK_PAINT();
+
+    // Журнал при воспроизведении не ведётся (см. main): досылка сообщений прошлых запусков
+    // сдвинула бы расписание команд и попала бы в статистику прогона
+    log_details(&logger, "Starting replay");
+
+    while ((result = trace_read(&trace_reader, record)) == 1) {
+        // Входящие строки модема приходят от сервера заново, воспроизводятся только команды
+        if (record->type != TRACE_USER_COMMAND) {
+            continue;
+        }
+        if (replay_speed > 0) {
+            // Выдерживание исходных интервалов с учётом коэффициента ускорения
+            unsigned long long due_us = (unsigned long long)(record->timestamp_us / replay_speed);
+            while (trace_clock_us() - replay_start_us < due_us) {
+                check_timeout(socket_fd, my_address);
+                Sleep(1);
+            }
+        } else {
+            // Максимальная скорость: следующая команда только после завершения предыдущей
+            while (client_state != IDLE) {
+                check_timeout(socket_fd, my_address);
+                Sleep(1);
+            }
+        }
+        replay_commands_started++;
+        if (process_command(socket_fd, my_address, record->data)) {
+            break;
+        }
+    }
+    if (result < 0) {
+        log_details(&logger, "Replay trace is corrupted");
+        console_printf("Replay trace is corrupted\n");
     }
+    replay_commands_started = INT_MAX;  // Подача строк модема больше не ждёт команд
 
-    // Установка параметров клиента из параметров консоли
-    char *ip = argv[1];
-    int port = atoi(argv[2]);
-    int my_address = 1;
-    char *last_octet = strrchr(ip, '.');
-    if (last_octet) {
-        my_address = atoi(last_octet + 1);
+    // Ожидание завершения последней передачи
+    while (client_state != IDLE) {
+        check_timeout(socket_fd, my_address);
+        Sleep(10);
     }
+    log_details(&logger, "Replay finished");
+    log_stack_usage("replay_commands", STACK_HIGH_WATER());
+    return 0;
+}
 
-    init_logger(&logger, ip); // Инициализация логера
+/// @brief Ожидание состояния клиента, в котором был принят записанный ответ модема
+/// Без сервера ответ не может прийти раньше запроса: CTS подаётся после отправки RTS,
+/// DELIVERED - после отправки INFO (но не дольше таймаута, если в записи ответ был лишним).
+/// @param my_address   - гидроакустический адрес текущего клиента
+/// @param data         - записанная строка модема
+static void wait_for_handshake(int my_address, char *data) {
+    Packet packet;
+    ClientState expected;
 
-    // Инициализация сети
-    WSADATA wsaData;
-    SOCKET client_socket;
-    struct sockaddr_in server_addr;
+    if (dacap_parse_packet(data, &packet) != 0) {
+        return;
+    }
+    if (packet.type == MSG_CTS && packet.dest == my_address) {
+        expected = SENDING_RTS;
+    } else if (packet.type == MSG_DELIVERED) {
+        expected = SENDING_INFO;
+    } else {
+        return;
+    }
+    DWORD start = GetTickCount();
+    while (client_state != expected && (GetTickCount() - start) < TIMEOUT_MS) {
+        Sleep(1);
+    }
+}
 
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        printf("Failed to initialize Winsock.\n");
-        log_details(&logger, "Failed to initialize Winsock");
-        close_logger(&logger);
-        return 1;
+/// @brief Функция подачи строк модема из трассы в тракт приёма (режим без сервера)
+/// Строки подаются в те же моменты относительно начала воспроизведения, что и команды,
+/// но не раньше команд, записанных перед ними, и не раньше запроса, на который они отвечают.
+/// Поэтому порядок запросов и ответов сохраняется при любой скорости воспроизведения.
+/// @param params - структура параметров подключения
+/// @return 
+DWORD WINAPI replay_modem_lines(LPVOID params) {
+    // Выгрузка параметров подключения из структуры
+    int *args = (int *)params;
+    int socket_fd = args[0];
+    int my_address = args[1];
+    TraceRecord *record = &modem_record;
+    int commands_seen = 0;
+    int result;
+
+    STACK_PAINT();
+    log_details(&logger, "Starting offline modem replay");
+    while ((result = trace_read(&modem_reader, record)) == 1) {
+        if (record->type != TRACE_MODEM_LINE) {
+            commands_seen++;
+            continue;
+        }
+        while (replay_commands_started < commands_seen) {
+            Sleep(1);
+        }
+        if (replay_speed > 0) {
+            unsigned long long due_us = (unsigned long long)(record->timestamp_us / replay_speed);
+            while (trace_clock_us() - replay_start_us < due_us) {
+                Sleep(1);
+            }
+        }
+        wait_for_handshake(my_address, record->data);
+        receive_modem_data(socket_fd, my_address, record->data, record->length);
     }
+    if (result < 0) {
+        log_details(&logger, "Replay trace is corrupted");
+    }
+    log_details(&logger, "Offline modem replay finished");
+    log_stack_usage("replay_modem_lines", STACK_HIGH_WATER());
+    return 0;
+}
+
+/// @brief Подключение к серверу и отправка ему собственного адреса
+/// @param ip           - IP адрес сервера
+/// @param port         - порт сервера
+/// @param my_address   - гидроакустический адрес текущего клиента
+/// @return             - сокет или INVALID_SOCKET при ошибке
+static SOCKET connect_to_server(const char *ip, int port, int my_address) {
+    SOCKET client_socket;
+    struct sockaddr_in server_addr;
 
     // Создание сокета
     client_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (client_socket == INVALID_SOCKET) {
         printf("Socket creation failed: %d\n", WSAGetLastError());
         log_details(&logger, "Socket creation failed");
-        close_logger(&logger);
-        WSACleanup();
-        return 1;
+        return INVALID_SOCKET;
     }
 
     printf("Client is active with node address %d!\n", my_address);
@@ -394,10 +872,8 @@ int main(int argc, char *argv[]) {
     if (connect(client_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
         printf("Connection failed: %d\n", WSAGetLastError());
         log_details(&logger, "Connection failed");
-        close_logger(&logger);
         closesocket(client_socket);
-        WSACleanup();
-        return 1;
+        return INVALID_SOCKET;
     }
 
     printf("Connected to server %s:%d\n", ip, port);
@@ -414,28 +890,188 @@ int main(int argc, char *argv[]) {
         printf("Failed to send INIT: %d\n", WSAGetLastError());
         log_details(&logger, "Failed to send INIT");
         closesocket(client_socket);
+        return INVALID_SOCKET;
+    }
+    return client_socket;
+}
+
+int main(int argc, char *argv[]) {
+    // Проверка введённых параметров консоли согласно формату:
+    // ./client.exe 127.0.0.n 9200 [--durability none|os|group|sync] [--capture <trace>]
+    //              [--replay <trace> [--offline] [--speed <N>|max] [--save-stats <file>] [--baseline <file>]]
+    const char *capture_path = NULL;    // Файл для записи трассы
+    const char *replay_path = NULL;     // Файл воспроизводимой трассы
+    const char *save_stats_path = NULL; // Файл для сохранения статистики прогона
+    const char *baseline_path = NULL;   // Файл эталонной статистики
+    int usage_error = argc < 3;
+
+    STACK_PAINT();
+    for (int i = 3; i < argc && !usage_error; i++) {
+        if (strcmp(argv[i], "--offline") == 0) {
+            offline_mode = 1;
+        } else if (i + 1 >= argc) {
+            usage_error = 1;
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0) {
+            i++;
+            replay_speed = strcmpi(argv[i], "max") == 0 ? 0.0 : atof(argv[i]);
+            usage_error = strcmpi(argv[i], "max") != 0 && replay_speed <= 0.0;
+        } else if (strcmp(argv[i], "--save-stats") == 0) {
+            save_stats_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--durability") == 0) {
+            static const char *levels[] = {"none", "os", "group", "sync"};
+            i++;
+            usage_error = 1;
+            for (int level = 0; level < 4; level++) {
+                if (strcmpi(argv[i], levels[level]) == 0) {
+                    journal_durability = (JournalDurability)level;
+                    usage_error = 0;
+                }
+            }
+        } else {
+            usage_error = 1;
+        }
+    }
+    usage_error = usage_error || (offline_mode && !replay_path);
+    if (usage_error) {
+        printf("Usage: %s <IP Address> <Port> [--durability none|os|group|sync] [--capture <trace>]\n"
+               "       [--replay <trace> [--offline] [--speed <N>|max] [--save-stats <file>] [--baseline <file>]]\n"
+               "       (--offline requires --replay)\n", argv[0]);
+        return 1;
+    }
+
+    // Установка параметров клиента из параметров консоли
+    char *ip = argv[1];
+    int port = atoi(argv[2]);
+    int my_address = 1;
+    char *last_octet = strrchr(ip, '.');
+    if (last_octet) {
+        my_address = atoi(last_octet + 1);
+    }
+
+    init_logger(&logger, ip); // Инициализация логера
+    dacap_encoder_init(&tx_encoder);
+    dacap_encoder_init(&rx_encoder);
+
+    // Инициализация сети
+    WSADATA wsaData;
+    SOCKET client_socket = INVALID_SOCKET;
+
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        printf("Failed to initialize Winsock.\n");
+        log_details(&logger, "Failed to initialize Winsock");
+        close_logger(&logger);
+        return 1;
+    }
+
+    if (offline_mode) {
+        // Без сервера: строки модема подаются из трассы, отправляемые строки никуда не уходят
+        printf("Client is active with node address %d!\n", my_address);
+        printf("Offline replay: modem lines are fed from %s\n", replay_path);
+        log_details(&logger, "Client started in offline replay mode");
+    } else {
+        client_socket = connect_to_server(ip, port, my_address);
+        if (client_socket == INVALID_SOCKET) {
+            close_logger(&logger);
+            WSACleanup();
+            return 1;
+        }
+    }
+
+    // Открытие журнала исходящей очереди и восстановление неподтверждённых сообщений
+    char journal_prefix[32];
+    snprintf(journal_prefix, sizeof(journal_prefix), "journal_%s", ip);
+    // При воспроизведении журнал не ведётся: статистика прогона не должна зависеть
+    // от сообщений, оставшихся в journal_<ip> после прошлых запусков
+    if (replay_path) {
+        journal_durability = JOURNAL_DURABILITY_NONE;
+    }
+    int recovered = journal_open(&journal, journal_prefix, journal_durability);
+    if (recovered < 0) {
+        printf("Failed to open journal, messages will not survive restart\n");
+        log_details(&logger, "Failed to open journal");
+    } else if (recovered > 0) {
+        printf("Recovered %d unacknowledged messages from journal\n", recovered);
+    }
+    journal_enabled = recovered >= 0 && journal_durability != JOURNAL_DURABILITY_NONE;
+
+    // Открытие трасс для записи и воспроизведения
+    if (capture_path && trace_open_writer(&trace_writer, capture_path) == 0) {
+        capture_enabled = 1;
+        log_details(&logger, "Trace capture started");
+    }
+    if (replay_path && (trace_open_reader(&trace_reader, replay_path) != 0 ||
+                        (offline_mode && trace_open_reader(&modem_reader, replay_path) != 0))) {
+        log_details(&logger, "Failed to open replay trace");
+        if (client_socket != INVALID_SOCKET) {
+            closesocket(client_socket);
+        }
+        trace_close_reader(&trace_reader);
+        trace_close_writer(&trace_writer);
+        journal_close(&journal);
         close_logger(&logger);
         WSACleanup();
         return 1;
     }
 
     // Создание двух потоков: для чтения и записи из порта
+    // (при воспроизведении команды берутся из трассы, а не из консоли,
+    // а в режиме без сервера и строки модема берутся из трассы, а не из сокета)
     int args[2] = {client_socket, my_address};
-    HANDLE read_thread = CreateThread(NULL, 0, read_from_socket, args, 0, NULL);
-    HANDLE write_thread = CreateThread(NULL, 0, write_to_client, args, 0, NULL);
+    replay_start_us = trace_clock_us();
+    HANDLE read_thread = CreateThread(NULL, 0, offline_mode ? replay_modem_lines : read_from_socket, args, 0, NULL);
+    HANDLE write_thread = CreateThread(NULL, 0, replay_path ? replay_commands : write_to_client, args, 0, NULL);
 
-    // Ожидание завершения потоков
-    WaitForSingleObject(read_thread, INFINITE);
+    // Ожидание завершения потоков: после выхода потока записи
+    // соединение закрывается на приём, чтобы поток чтения вышел из recv
     WaitForSingleObject(write_thread, INFINITE);
+    if (client_socket != INVALID_SOCKET) {
+        shutdown(client_socket, SD_BOTH);
+    }
+    WaitForSingleObject(read_thread, INFINITE);
+
+    // Итоги воспроизведения и сравнение с эталоном
+    if (replay_path) {
+        run_stats.success = success_count;
+        run_stats.failure = failure_count;
+        printf("Replay completed: %d successes, %d failures\n", success_count, failure_count);
+        if (save_stats_path) {
+            trace_stats_save(&run_stats, save_stats_path);
+        }
+        if (baseline_path) {
+            static TraceStats baseline_stats;   // Гистограмма слишком велика для стека
+            if (trace_stats_load(&baseline_stats, baseline_path) == 0) {
+                trace_stats_compare(&run_stats, &baseline_stats, stdout);
+            }
+        }
+        trace_close_reader(&trace_reader);
+        trace_close_reader(&modem_reader);
+    }
+    trace_close_writer(&trace_writer);
+    journal_close(&journal);
+    if (journal_enabled) {
+        log_stack_usage("journal_flusher", journal.stack_used);
+    }
 
     // Закрытие соединения с сокетом
-    closesocket(client_socket);
+    if (client_socket != INVALID_SOCKET) {
+        closesocket(client_socket);
+    }
     
     
     WSACleanup();
     printf("Disconnected from server\n");
     log_details(&logger, "Disconnected from server");
     
+    log_stack_usage("main", STACK_HIGH_WATER());
+#ifdef DACAP_EMBEDDED
+    log_dump(&logger, stdout);  // Выгрузка кольцевого журнала перед завершением
+#endif
     close_logger(&logger);  // Закрытие файла лога
     
     return 0;
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Проверка профиля DACAP_EMBEDDED: после инициализации рабочий цикл клиента не выделяет память.
+// #pragma GCC poison в embedded.h ловит только вызовы malloc в коде клиента, а этот тест
+// перехватывает malloc/calloc/realloc всего процесса, поэтому видит и выделения внутри
+// библиотеки C: ленивый буфер stdout при первом printf, буфер FILE при fwrite/fflush, perror.
+// main.c подключается целиком (его main переименован), чтобы в замер попал тракт приёма
+// и обработки команд самого клиента, а не только библиотечный слой.
+// Собирается на Linux (glibc) с заменой Win32 API из tests/win32, см. README.
+// Код возврата: 0 - выделений не было, 1 - были, 2 - перехват не работает.
+
+#define DEFAULT_ITERATIONS 20000    // Итераций рабочего цикла
+#define TIMEOUT_EVERY      16       // Каждое такое сообщение не доставляется и уходит по таймауту
+#define JOURNAL_PREFIX     "alloc_test_journal"
+#define TRACE_PATH         "alloc_test.trace"
+#define MY_ADDRESS         2
+
+// Перехват динамической памяти: вызовы передаются в glibc и считаются, пока идёт замер.
+// Определяется до подключения main.c: embedded.h запрещает эти имена в последующем коде.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static volatile int counting = 0;   // Признак замера
+static int allocations = 0;         // Выделения во время замера (из всех потоков)
+
+static void count_allocation(void) {
+    if (counting) {
+        __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void *malloc(size_t size) {
+    count_allocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    count_allocation();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    count_allocation();
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    __libc_free(ptr);
+}
+
+#define main client_main
+#include "../main.c"
+#undef main
+
+/// @brief Подача блока данных в тракт приёма клиента, как после recv
+static void receive(const char *data) {
+    char buffer[BUFFER_SIZE];
+    int length = (int)strlen(data);
+
+    memcpy(buffer, data, (size_t)length + 1);
+    receive_modem_data(-1, MY_ADDRESS, buffer, length);
+}
+
+/// @brief Ввод пользовательской команды
+static void command(const char *text) {
+    char line[100];
+
+    strncpy(line, text, sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+    process_command(-1, MY_ADDRESS, line);
+}
+
+/// @brief Один проход рабочего цикла клиента: команда, рукопожатие, входящие пакеты
+static void work(long i) {
+    command("Message 3,7");
+    command("Message 4,7");                 // Клиент занят: сообщение отбрасывается
+    if (i % TIMEOUT_EVERY == TIMEOUT_EVERY - 1) {
+        // Адресат не отвечает: повторные попытки по таймауту, затем сообщение остаётся в журнале
+        while (client_state != IDLE) {
+            pending.start_time = GetTickCount() - TIMEOUT_MS - 1;
+            check_timeout(-1, MY_ADDRESS);
+        }
+    } else {
+        // CTS приходит двумя блоками recv, DELIVERED - вместе с чужим RTS
+        receive("RECVIM,3,7,2,ack,1000,-50,100,0.1,C");
+        receive("TS\r\n");
+        receive("DELIVERED,7\r\nRECVIM,3,5,2,ack,1000,-50,100,0.1,RTS\r\n");
+    }
+    receive("RECVIM,13,5,2,ack,1000,-50,100,0.1,INFO;Message 3\r\n");
+    receive("AT*SENDIM,3,7,noack,RTS\r\n");  // Неизвестная строка
+    check_timeout(-1, MY_ADDRESS);
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    int full_fd;
+    int during_work, during_error, probe;
+
+    // Инициализация, как в main клиента: здесь выделения разрешены
+    unlink(JOURNAL_PREFIX ".0");
+    unlink(JOURNAL_PREFIX ".1");
+    full_fd = open("/dev/full", O_WRONLY);
+    init_logger(&logger, "alloc_test");
+    dacap_encoder_init(&tx_encoder);
+    dacap_encoder_init(&rx_encoder);
+    if (journal_open(&journal, JOURNAL_PREFIX, JOURNAL_DURABILITY_OS) < 0 || trace_open_writer(&trace_writer, TRACE_PATH) != 0) {
+        fprintf(stderr, "alloc_test: initialization failed\n");
+        return 2;
+    }
+    journal_enabled = 1;
+    capture_enabled = 1;
+    offline_mode = 1;   // Строки модема никуда не отправляются
+
+    // Замер рабочего цикла. Вывод на stdout до конца замера запрещён: первый printf
+    // выделил бы буфер stdout, а этот случай тест и должен ловить в коде клиента.
+    counting = 1;
+    for (long i = 0; i < iterations; i++) {
+        work(i);
+    }
+    journal_wait(&journal, journal.appended_seq);
+    during_work = allocations;
+
+    // Ошибка записи журнала: поток сброса и клиент сообщают о ней
+    if (full_fd >= 0) {
+        EnterCriticalSection(&journal.lock);
+        dup2(full_fd, journal.fd);
+        LeaveCriticalSection(&journal.lock);
+        command("Message 5,7");
+        command("Message 6,7");
+    }
+    during_error = allocations - during_work;
+    journal_close(&journal);
+    counting = 0;
+
+    // Проверка самого перехвата: fopen выделяет FILE через malloc внутри glibc
+    counting = 1;
+    probe = allocations;
+    FILE *file = fopen(TRACE_PATH, "rb");
+    probe = allocations - probe;
+    counting = 0;
+    if (file) fclose(file);
+
+    trace_close_writer(&trace_writer);
+    close_logger(&logger);
+    if (full_fd >= 0) close(full_fd);
+    unlink(JOURNAL_PREFIX ".0");
+    unlink(JOURNAL_PREFIX ".1");
+    unlink(TRACE_PATH);
+
+    printf("iterations: %ld, delivered: %d, failed: %d, not durable: %d\n",
+           iterations, success_count, failure_count, journal_dropped);
+    printf("allocations in work loop: %d\n", during_work);
+    printf("allocations on journal write error: %d\n", during_error);
+    printf("journal flusher stack high-water: %d bytes\n", journal.stack_used);
+    if (probe == 0) {
+        printf("FAIL: malloc interposition does not see allocations inside the C library\n");
+        return 2;
+    }
+    if (success_count == 0 || journal_dropped == 0) {
+        printf("FAIL: work loop did not reach delivery and journal overflow paths\n");
+        return 2;
+    }
+    if (during_work != 0 || during_error != 0) {
+        printf("FAIL: memory allocated after initialization\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
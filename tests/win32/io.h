@@ -0,0 +1,28 @@
+#ifndef TESTS_WIN32_IO_H
+#define TESTS_WIN32_IO_H
+
+// Функции ввода-вывода CRT (io.h) через POSIX для сборки тестов на Linux
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define _open       open
+#define _close      close
+#define _read       read
+#define _write      write
+#define _lseek      lseek
+#define _unlink     unlink
+#define _commit     fsync
+
+#define _O_RDONLY   O_RDONLY
+#define _O_WRONLY   O_WRONLY
+#define _O_RDWR     O_RDWR
+#define _O_CREAT    O_CREAT
+#define _O_TRUNC    O_TRUNC
+#define _O_APPEND   O_APPEND
+#define _O_BINARY   0
+
+#define _S_IREAD    0400
+#define _S_IWRITE   0200
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef TESTS_WIN32_WINDOWS_H
+#define TESTS_WIN32_WINDOWS_H
+
+// Минимальная замена Win32 API на POSIX для сборки тестов на Linux (glibc).
+// Только то, чем пользуются main.c, dacap.c, logger/logger.c, trace/trace.c и journal/journal.c.
+// Сами функции не должны выделять память после создания объектов, как и настоящий Win32 API.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef unsigned long DWORD;
+typedef unsigned short WORD;
+typedef int BOOL;
+typedef void *HANDLE;
+typedef void *LPVOID;
+typedef union {
+    struct { DWORD LowPart; long HighPart; } u;
+    long long QuadPart;
+} LARGE_INTEGER;
+
+#define WINAPI
+#define INFINITE 0xFFFFFFFF
+
+typedef pthread_mutex_t CRITICAL_SECTION;
+typedef pthread_cond_t CONDITION_VARIABLE;
+
+static inline void InitializeCriticalSection(CRITICAL_SECTION *cs) { pthread_mutex_init(cs, NULL); }
+static inline void DeleteCriticalSection(CRITICAL_SECTION *cs) { pthread_mutex_destroy(cs); }
+static inline void EnterCriticalSection(CRITICAL_SECTION *cs) { pthread_mutex_lock(cs); }
+static inline void LeaveCriticalSection(CRITICAL_SECTION *cs) { pthread_mutex_unlock(cs); }
+
+static inline void InitializeConditionVariable(CONDITION_VARIABLE *cv) { pthread_cond_init(cv, NULL); }
+static inline void WakeConditionVariable(CONDITION_VARIABLE *cv) { pthread_cond_signal(cv); }
+static inline void WakeAllConditionVariable(CONDITION_VARIABLE *cv) { pthread_cond_broadcast(cv); }
+
+static inline BOOL SleepConditionVariableCS(CONDITION_VARIABLE *cv, CRITICAL_SECTION *cs, DWORD ms) {
+    struct timespec deadline;
+    if (ms == INFINITE) {
+        return pthread_cond_wait(cv, cs) == 0;
+    }
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cv, cs, &deadline) == 0;
+}
+
+static inline void Sleep(DWORD ms) { usleep((useconds_t)ms * 1000); }
+
+// Поток: описатель создаётся при запуске (инициализация), освобождается в CloseHandle
+typedef struct {
+    pthread_t thread;
+    DWORD (*start)(LPVOID);
+    LPVOID param;
+} Win32Thread;
+
+static void *win32_thread_start(void *param) {
+    Win32Thread *thread = (Win32Thread *)param;
+    thread->start(thread->param);
+    return NULL;
+}
+
+static inline HANDLE CreateThread(void *attributes, size_t stack_size, DWORD (*start)(LPVOID), LPVOID param,
+                                  DWORD flags, DWORD *id) {
+    Win32Thread *thread = (Win32Thread *)malloc(sizeof(*thread));
+    (void)attributes; (void)stack_size; (void)flags; (void)id;
+    if (!thread) return NULL;
+    thread->start = start;
+    thread->param = param;
+    if (pthread_create(&thread->thread, NULL, win32_thread_start, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+static inline DWORD WaitForSingleObject(HANDLE handle, DWORD ms) {
+    (void)ms;
+    pthread_join(((Win32Thread *)handle)->thread, NULL);
+    return 0;
+}
+
+static inline BOOL CloseHandle(HANDLE handle) {
+    free(handle);
+    return 1;
+}
+
+static inline DWORD GetTickCount(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (DWORD)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+static inline BOOL QueryPerformanceFrequency(LARGE_INTEGER *frequency) {
+    frequency->QuadPart = 1000000000LL;
+    return 1;
+}
+
+static inline BOOL QueryPerformanceCounter(LARGE_INTEGER *counter) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    counter->QuadPart = (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+    return 1;
+}
+
+typedef struct {
+    WORD wYear, wMonth, wDayOfWeek, wDay, wHour, wMinute, wSecond, wMilliseconds;
+} SYSTEMTIME;
+
+// Дата считается без gmtime_r: первый вызов функций времени glibc может выделить память под часовой пояс
+static inline void GetSystemTime(SYSTEMTIME *st) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    long long days = now.tv_sec / 86400;
+    long seconds = (long)(now.tv_sec % 86400);
+    // Перевод номера дня от 1970-01-01 в дату григорианского календаря
+    long long z = days + 719468;
+    long long era = z / 146097;
+    long long doe = z - era * 146097;
+    long long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long long mp = (5 * doy + 2) / 153;
+    long long month = mp < 10 ? mp + 3 : mp - 9;
+    st->wYear = (WORD)(yoe + era * 400 + (month <= 2));
+    st->wMonth = (WORD)month;
+    st->wDay = (WORD)(doy - (153 * mp + 2) / 5 + 1);
+    st->wDayOfWeek = (WORD)((days + 4) % 7);
+    st->wHour = (WORD)(seconds / 3600);
+    st->wMinute = (WORD)(seconds / 60 % 60);
+    st->wSecond = (WORD)(seconds % 60);
+    st->wMilliseconds = (WORD)(now.tv_nsec / 1000000);
+}
+
+// Консоль: в тестах ввода нет, поток записи не читает клавиатуру
+#define STD_INPUT_HANDLE ((DWORD)-10)
+#define KEY_EVENT 1
+
+typedef struct {
+    BOOL bKeyDown;
+    union { char AsciiChar; } uChar;
+} KEY_EVENT_RECORD;
+
+typedef struct {
+    WORD EventType;
+    union { KEY_EVENT_RECORD KeyEvent; } Event;
+} INPUT_RECORD;
+
+static inline HANDLE GetStdHandle(DWORD handle) {
+    (void)handle;
+    return NULL;
+}
+
+static inline BOOL PeekConsoleInput(HANDLE console, INPUT_RECORD *records, DWORD length, DWORD *read) {
+    (void)console; (void)records; (void)length;
+    *read = 0;
+    return 0;
+}
+
+static inline BOOL ReadConsoleInput(HANDLE console, INPUT_RECORD *records, DWORD length, DWORD *read) {
+    (void)console; (void)records; (void)length;
+    *read = 0;
+    return 0;
+}
+
+// Сравнение без учёта регистра из CRT
+#define strcmpi strcasecmp
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef TESTS_WIN32_WINSOCK2_H
+#define TESTS_WIN32_WINSOCK2_H
+
+// Winsock через сокеты POSIX для сборки тестов на Linux
+
+#include <errno.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "windows.h"
+
+typedef int SOCKET;
+typedef struct { WORD wVersion; } WSADATA;
+
+#define INVALID_SOCKET  (-1)
+#define SOCKET_ERROR    (-1)
+#define WSAEWOULDBLOCK  EWOULDBLOCK
+#define SD_BOTH         SHUT_RDWR
+#define MAKEWORD(low, high) ((WORD)(((low) & 0xFF) | (((high) & 0xFF) << 8)))
+
+static inline int WSAStartup(WORD version, WSADATA *data) {
+    data->wVersion = version;
+    return 0;
+}
+
+static inline int WSACleanup(void) { return 0; }
+static inline int WSAGetLastError(void) { return errno; }
+static inline int closesocket(SOCKET socket) { return close(socket); }
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef TESTS_WIN32_WS2TCPIP_H
+#define TESTS_WIN32_WS2TCPIP_H
+
+// inet_pton объявлен в arpa/inet.h, который подключает winsock2.h
+
+#include "winsock2.h"
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include <windows.h>
+#include "trace.h"
+#include "../embedded.h"
+
+// Формат трассы: заголовок "DTRC" + версия, далее записи вида
+// <тип:1 байт><приращение времени, мкс:varint><длина:varint><данные>
+#define TRACE_MAGIC     "DTRC"
+#define TRACE_VERSION   1
+
+/// @brief Запись беззнакового числа в формате varint (7 бит на байт)
+/// @param p        - позиция записи
+/// @param value    - число
+/// @return         - количество записанных байт
+static int put_varint(unsigned char *p, unsigned long long value) {
+    int n = 0;
+    while (value >= 0x80) {
+        p[n++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (unsigned char)value;
+    return n;
+}
+
+/// @brief Чтение числа в формате varint из файла
+/// @param file     - файл трассы
+/// @param value    - прочитанное число
+/// @return         - 0 при успехе, -1 при ошибке или конце файла
+static int get_varint(FILE *file, unsigned long long *value) {
+    int shift = 0;
+    int c;
+    *value = 0;
+    while ((c = fgetc(file)) != EOF) {
+        *value |= (unsigned long long)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            return 0;
+        }
+        shift += 7;
+        if (shift > 63) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+unsigned long long trace_clock_us(void) {
+    static LARGE_INTEGER frequency;     // Частота счётчика постоянна, запрашивается один раз
+    LARGE_INTEGER now;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&now);
+    // Деление по частям, чтобы произведение на 1000000 не переполнялось
+    return (unsigned long long)(now.QuadPart / frequency.QuadPart) * 1000000ULL +
+           (unsigned long long)(now.QuadPart % frequency.QuadPart) * 1000000ULL / (unsigned long long)frequency.QuadPart;
+}
+
+int trace_open_writer(TraceWriter *writer, const char *path) {
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        perror("Failed to open trace file");
+        return -1;
+    }
+    fwrite(TRACE_MAGIC, 1, 4, writer->file);
+    fputc(TRACE_VERSION, writer->file);
+    fflush(writer->file);
+
+    InitializeCriticalSection(&writer->lock);
+    writer->start_us = trace_clock_us();
+    writer->last_us = 0;
+    return 0;
+}
+
+void trace_record(TraceWriter *writer, TraceRecordType type, const char *data, int length) {
+    unsigned char header[1 + 10 + 10];  // Тип + два varint максимальной длины
+    int header_len = 0;
+    unsigned long long now_us;
+
+    if (!writer->file) return;
+    if (length > TRACE_MAX_DATA) {
+        length = TRACE_MAX_DATA;
+    }
+
+    EnterCriticalSection(&writer->lock);
+    // Время берётся под блокировкой, чтобы приращения между записями не были отрицательными
+    now_us = trace_clock_us() - writer->start_us;
+    header[header_len++] = (unsigned char)type;
+    header_len += put_varint(header + header_len, now_us - writer->last_us);
+    header_len += put_varint(header + header_len, (unsigned long long)length);
+    writer->last_us = now_us;
+
+    fwrite(header, 1, header_len, writer->file);
+    fwrite(data, 1, length, writer->file);
+    fflush(writer->file);
+    LeaveCriticalSection(&writer->lock);
+}
+
+void trace_close_writer(TraceWriter *writer) {
+    if (writer->file) {
+        fclose(writer->file);
+        writer->file = NULL;
+        DeleteCriticalSection(&writer->lock);
+    }
+}
+
+int trace_open_reader(TraceReader *reader, const char *path) {
+    char magic[5];
+
+    reader->last_us = 0;
+    reader->file = fopen(path, "rb");
+    if (!reader->file) {
+        perror("Failed to open trace file");
+        return -1;
+    }
+    if (fread(magic, 1, 5, reader->file) != 5 || memcmp(magic, TRACE_MAGIC, 4) != 0 || magic[4] != TRACE_VERSION) {
+        fprintf(stderr, "Unsupported trace format: %s\n", path);
+        fclose(reader->file);
+        reader->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int trace_read(TraceReader *reader, TraceRecord *record) {
+    unsigned long long delta_us, length;
+    int type;
+
+    if (!reader->file) return -1;
+    type = fgetc(reader->file);
+    if (type == EOF) {
+        return 0;
+    }
+    if ((type != TRACE_USER_COMMAND && type != TRACE_MODEM_LINE) ||
+        get_varint(reader->file, &delta_us) != 0 ||
+        get_varint(reader->file, &length) != 0 ||
+        length > TRACE_MAX_DATA ||
+        fread(record->data, 1, (size_t)length, reader->file) != length) {
+        return -1;
+    }
+    reader->last_us += delta_us;
+    record->type = (TraceRecordType)type;
+    record->timestamp_us = reader->last_us;
+    record->length = (int)length;
+    record->data[length] = '\0';
+    return 1;
+}
+
+void trace_close_reader(TraceReader *reader) {
+    if (reader->file) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+}
+
+void trace_stats_add_latency(TraceStats *stats, unsigned long latency_ms) {
+    if (latency_ms > TRACE_STATS_MAX_LATENCY_MS) {
+        latency_ms = TRACE_STATS_MAX_LATENCY_MS;
+    }
+    stats->latency_ms[latency_ms]++;
+    stats->latency_count++;
+}
+
+unsigned int trace_stats_percentile(const TraceStats *stats, double percentile) {
+    unsigned long long rank, seen = 0;
+
+    if (stats->latency_count == 0) return 0;
+    // Ранг ближайшего сверху замера (nearest-rank)
+    rank = (unsigned long long)(percentile / 100.0 * stats->latency_count + 0.999999);
+    if (rank == 0) rank = 1;
+    for (unsigned int ms = 0; ms <= TRACE_STATS_MAX_LATENCY_MS; ms++) {
+        seen += stats->latency_ms[ms];
+        if (seen >= rank) {
+            return ms;
+        }
+    }
+    return TRACE_STATS_MAX_LATENCY_MS;
+}
+
+int trace_stats_save(const TraceStats *stats, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror("Failed to open stats file");
+        return -1;
+    }
+    fprintf(file, "success,%d\n", stats->success);
+    fprintf(file, "failure,%d\n", stats->failure);
+    // Гистограмма хранится разреженно: только непустые интервалы
+    for (unsigned int ms = 0; ms <= TRACE_STATS_MAX_LATENCY_MS; ms++) {
+        if (stats->latency_ms[ms]) {
+            fprintf(file, "latency,%u,%u\n", ms, stats->latency_ms[ms]);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+int trace_stats_load(TraceStats *stats, const char *path) {
+    char line[64];
+    unsigned int ms, count;
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror("Failed to open stats file");
+        return -1;
+    }
+    memset(stats, 0, sizeof(*stats));
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "latency,%u,%u", &ms, &count) == 2) {
+            if (ms > TRACE_STATS_MAX_LATENCY_MS) ms = TRACE_STATS_MAX_LATENCY_MS;
+            stats->latency_ms[ms] += count;
+            stats->latency_count += count;
+        } else if (sscanf(line, "success,%d", &stats->success) != 1) {
+            sscanf(line, "failure,%d", &stats->failure);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/// @brief Доля успешных передач в процентах
+static double success_ratio(const TraceStats *stats) {
+    int total = stats->success + stats->failure;
+    return total ? 100.0 * stats->success / total : 0.0;
+}
+
+void trace_stats_compare(const TraceStats *current, const TraceStats *baseline, FILE *out) {
+    static const double percentiles[] = {50.0, 90.0, 99.0, 100.0};
+
+    fprintf(out, "%-12s %10s %10s %10s\n", "metric", "baseline", "current", "delta");
+    fprintf(out, "%-12s %10d %10d %+10d\n", "success", baseline->success, current->success, current->success - baseline->success);
+    fprintf(out, "%-12s %10d %10d %+10d\n", "failure", baseline->failure, current->failure, current->failure - baseline->failure);
+    fprintf(out, "%-12s %9.1f%% %9.1f%% %+9.1f%%\n", "success %", success_ratio(baseline), success_ratio(current),
+            success_ratio(current) - success_ratio(baseline));
+    for (int i = 0; i < (int)(sizeof(percentiles) / sizeof(percentiles[0])); i++) {
+        char name[16];
+        unsigned int b = trace_stats_percentile(baseline, percentiles[i]);
+        unsigned int c = trace_stats_percentile(current, percentiles[i]);
+        snprintf(name, sizeof(name), "p%.0f ms", percentiles[i]);
+        fprintf(out, "%-12s %10u %10u %+10d\n", name, b, c, (int)c - (int)b);
+    }
+}
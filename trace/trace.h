@@ -0,0 +1,112 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <windows.h>
+#include "../config.h"
+
+#define TRACE_MAX_DATA BUFFER_SIZE  // Максимальный размер данных одной записи
+
+/// Виды записей в трассе
+typedef enum {
+    TRACE_USER_COMMAND = 1, // Команда пользователя (строка консоли)
+    TRACE_MODEM_LINE = 2    // Строка, принятая от модема/сервера
+} TraceRecordType;
+
+/// @brief Одна запись трассы
+typedef struct {
+    TraceRecordType type;               // Вид записи
+    unsigned long long timestamp_us;    // Время от начала записи трассы, мкс
+    int length;                         // Длина данных
+    char data[TRACE_MAX_DATA + 1];      // Данные записи (с завершающим нулём)
+} TraceRecord;
+
+/// @brief Объект записи трассы
+typedef struct {
+    FILE *file;                     // Файл трассы
+    CRITICAL_SECTION lock;          // Запись идёт из потоков чтения и записи сокета
+    unsigned long long start_us;    // Время начала записи по монотонному счётчику, мкс
+    unsigned long long last_us;     // Время предыдущей записи, мкс
+} TraceWriter;
+
+/// @brief Объект чтения трассы
+typedef struct {
+    FILE *file;                     // Файл трассы
+    unsigned long long last_us;     // Время предыдущей записи, мкс
+} TraceReader;
+
+/// @brief Статистика прогона для сравнения с эталоном
+typedef struct {
+    int success;                                            // Успешные передачи
+    int failure;                                            // Неудачные передачи
+    unsigned int latency_count;                             // Количество замеров задержки
+    unsigned int latency_ms[TRACE_STATS_MAX_LATENCY_MS + 1]; // Гистограмма задержек RTS -> DELIVERED, мс
+} TraceStats;
+
+/// @brief Функция получения времени по монотонному счётчику (QueryPerformanceCounter)
+/// @return - время, мкс
+unsigned long long trace_clock_us(void);
+
+/// @brief Функция открытия трассы на запись
+/// @param writer   - объект записи трассы
+/// @param path     - путь к файлу трассы
+/// @return         - 0 при успехе, -1 при ошибке
+int trace_open_writer(TraceWriter *writer, const char *path);
+
+/// @brief Функция добавления записи в трассу
+/// @param writer   - объект записи трассы
+/// @param type     - вид записи
+/// @param data     - данные
+/// @param length   - длина данных
+void trace_record(TraceWriter *writer, TraceRecordType type, const char *data, int length);
+
+/// @brief Функция закрытия трассы, открытой на запись
+/// @param writer   - объект записи трассы
+void trace_close_writer(TraceWriter *writer);
+
+/// @brief Функция открытия трассы на чтение
+/// @param reader   - объект чтения трассы
+/// @param path     - путь к файлу трассы
+/// @return         - 0 при успехе, -1 при ошибке или неверном формате
+int trace_open_reader(TraceReader *reader, const char *path);
+
+/// @brief Функция чтения очередной записи трассы
+/// @param reader   - объект чтения трассы
+/// @param record   - структура для записи
+/// @return         - 1 запись прочитана, 0 конец трассы, -1 повреждённая трасса
+int trace_read(TraceReader *reader, TraceRecord *record);
+
+/// @brief Функция закрытия трассы, открытой на чтение
+/// @param reader   - объект чтения трассы
+void trace_close_reader(TraceReader *reader);
+
+/// @brief Функция учёта задержки успешной передачи
+/// @param stats        - статистика прогона
+/// @param latency_ms   - задержка, мс
+void trace_stats_add_latency(TraceStats *stats, unsigned long latency_ms);
+
+/// @brief Функция вычисления перцентиля задержки
+/// @param stats        - статистика прогона
+/// @param percentile   - перцентиль (0..100)
+/// @return             - задержка, мс (0, если замеров нет)
+unsigned int trace_stats_percentile(const TraceStats *stats, double percentile);
+
+/// @brief Функция сохранения статистики в текстовый файл
+/// @param stats    - статистика прогона
+/// @param path     - путь к файлу
+/// @return         - 0 при успехе, -1 при ошибке
+int trace_stats_save(const TraceStats *stats, const char *path);
+
+/// @brief Функция загрузки статистики из файла
+/// @param stats    - статистика прогона
+/// @param path     - путь к файлу
+/// @return         - 0 при успехе, -1 при ошибке
+int trace_stats_load(TraceStats *stats, const char *path);
+
+/// @brief Функция вывода разницы между текущим прогоном и эталоном
+/// @param current  - статистика текущего прогона
+/// @param baseline - эталонная статистика
+/// @param out      - поток вывода
+void trace_stats_compare(const TraceStats *current, const TraceStats *baseline, FILE *out);
+
+#endif